@@ -0,0 +1,95 @@
+/*
+ * Measure the cost of delivering notifications to JavaScript, with and
+ * without the batchevents option.
+ *
+ * This needs a real controller.  It starts the driver, waits for the
+ * initial scan to complete, and reports how many notifications were
+ * delivered, how many times the addon entered JavaScript to deliver them,
+ * and how much CPU time the main thread used while doing so.  The OpenZWave
+ * threads are not counted, as they do the same work either way.  Run it once
+ * with each setting against the same network:
+ *
+ *	node bench/events.js /dev/ttyUSB0
+ *	node bench/events.js /dev/ttyUSB0 batch
+ */
+
+var fs = require('fs');
+var OpenZWave = require('../lib/openzwave.js');
+
+var path = process.argv[2] || '/dev/ttyUSB0';
+var batch = (process.argv[3] === 'batch');
+
+var zwave = new OpenZWave(path, {
+	batchevents: batch,
+});
+
+var names = ['connected', 'driver ready', 'driver failed', 'node added',
+	     'value added', 'value changed', 'value removed', 'node ready',
+	     'notification', 'scan complete'];
+var notifications = 0;
+var entries = 0;
+
+/*
+ * CPU time used by the main thread so far, in milliseconds.  On Linux the
+ * main thread's task id is the process id.
+ */
+function cputime() {
+	var stat = fs.readFileSync('/proc/self/task/' + process.pid + '/stat', 'utf8');
+	var fields = stat.slice(stat.lastIndexOf(')') + 2).split(' ');
+	/* utime and stime, in clock ticks of 10ms */
+	return (parseInt(fields[11], 10) + parseInt(fields[12], 10)) * 10;
+}
+
+/*
+ * Every call the addon makes into JavaScript goes through its emit.
+ */
+var emit = zwave.addon.emit;
+zwave.addon.emit = function() {
+	entries++;
+	return emit.apply(null, arguments);
+}
+
+if (batch) {
+	zwave.on('events', function(events) {
+		notifications += events.length;
+		events.forEach(function(ev) {
+			if (ev[0] === 'scan complete')
+				done();
+		});
+	});
+} else {
+	names.forEach(function(name) {
+		zwave.on(name, function() {
+			notifications++;
+		});
+	});
+	zwave.on('scan complete', function() {
+		done();
+	});
+}
+
+zwave.on('driver failed', function() {
+	console.log('failed to start driver');
+	zwave.disconnect();
+	process.exit(1);
+});
+
+var start;
+
+function done() {
+	var cpu = cputime() - start;
+	var deliver = zwave.getLatencyStats().stages.deliver;
+
+	console.log('batchevents: %s', batch);
+	console.log('notifications: %d, entries into JavaScript: %d',
+		    notifications, entries);
+	console.log('main thread cpu: %d ms, %d us per notification',
+		    cpu, Math.round(cpu * 1000 / notifications));
+	console.log('deliver latency: p50 %d ms, p99 %d ms, max %d ms',
+		    deliver.p50, deliver.p99, deliver.max);
+	zwave.disconnect();
+	process.exit();
+}
+
+start = cputime();
+zwave.connect();
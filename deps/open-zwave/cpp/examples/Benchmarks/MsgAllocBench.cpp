@@ -0,0 +1,180 @@
+//-----------------------------------------------------------------------------
+//
+//	MsgAllocBench.cpp
+//
+//	Counts the heap allocations made on the send path: creating a Msg,
+//	queuing it with Driver::SendMsg, writing it with Driver::WriteNextMsg
+//	and deleting it once it is done with.
+//
+//	The driver is never started and its controller is never opened, so
+//	the writes go nowhere and no Z-Wave hardware is needed.  The nodes the
+//	messages are addressed to do not exist, so no node is locked for long.
+//
+//	Copyright (c) 2010 Mal Lansell <mal@openzwave.com>
+//
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <new>
+#include "Defs.h"
+#include "Options.h"
+#include "Driver.h"
+#include "Msg.h"
+
+using namespace OpenZWave;
+
+static uint32 const c_queueDepth = 16;		// Messages queued before the queue is drained
+static uint32 const c_rounds = 20000;
+
+// Every call to the global operator new is counted while s_counting is set
+static bool s_counting = false;
+static uint64 s_allocations = 0;
+
+void* operator new( size_t _size )
+{
+	if( s_counting )
+	{
+		++s_allocations;
+	}
+	if( void* p = malloc( _size ? _size : 1 ) )
+	{
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete( void* _p ) throw()
+{
+	free( _p );
+}
+
+//-----------------------------------------------------------------------------
+// <Now>
+// Monotonic time in nanoseconds
+//-----------------------------------------------------------------------------
+static double Now
+(
+)
+{
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+namespace OpenZWave
+{
+	class DriverBench
+	{
+	public:
+		DriverBench(): m_driver( new Driver( "/dev/null", Driver::ControllerInterface_Serial ) ){}
+
+		//-----------------------------------------------------------------------------
+		// <DriverBench::Round>
+		// Queue c_queueDepth Basic Gets, then write and retire each of them
+		//-----------------------------------------------------------------------------
+		void Round
+		(
+			bool const _builtText
+		)
+		{
+			for( uint32 i=0; i<c_queueDepth; ++i )
+			{
+				uint8 nodeId = (uint8)( 2 + i );
+				Msg* msg;
+				if( _builtText )
+				{
+					char str[64];
+					snprintf( str, sizeof(str), "BasicCmd_Get (node %d)", nodeId );
+					msg = new Msg( string( str ), nodeId, REQUEST, FUNC_ID_ZW_SEND_DATA, true, true, FUNC_ID_APPLICATION_COMMAND_HANDLER, 0x20 );
+				}
+				else
+				{
+					msg = new Msg( "BasicCmd_Get", nodeId, REQUEST, FUNC_ID_ZW_SEND_DATA, true, true, FUNC_ID_APPLICATION_COMMAND_HANDLER, 0x20 );
+				}
+				msg->Append( nodeId );
+				msg->Append( 2 );
+				msg->Append( 0x20 );
+				msg->Append( 0x02 );
+				msg->Append( m_driver->GetTransmitOptions() );
+				m_driver->SendMsg( msg, Driver::MsgQueue_Send );
+			}
+
+			while( !m_driver->m_msgQueue[Driver::MsgQueue_Send].empty() )
+			{
+				m_driver->WriteNextMsg( Driver::MsgQueue_Send );
+				m_driver->RemoveCurrentMsg();
+			}
+		}
+
+		//-----------------------------------------------------------------------------
+		// <DriverBench::Run>
+		// Report the allocations and time per message over c_rounds rounds
+		//-----------------------------------------------------------------------------
+		void Run
+		(
+			char const* _name,
+			bool const _builtText
+		)
+		{
+			// The first round brings the queue up to its working depth
+			Round( _builtText );
+
+			s_allocations = 0;
+			s_counting = true;
+			double start = Now();
+			for( uint32 i=0; i<c_rounds; ++i )
+			{
+				Round( _builtText );
+			}
+			double elapsed = Now() - start;
+			s_counting = false;
+
+			double msgs = (double)c_rounds * c_queueDepth;
+			printf( "  %-30s %6.2f allocations/msg %8.0f ns/msg\n", _name, (double)s_allocations / msgs, elapsed / msgs );
+		}
+
+	private:
+		Driver*	m_driver;
+	};
+}
+
+int main( int argc, char* argv[] )
+{
+	Options::Create( "./", "./", "" );
+
+	DriverBench bench;
+
+	printf( "MsgAllocBench: %u rounds of %u messages\n", c_rounds, c_queueDepth );
+
+	// Without a pool, as when a message is created before the Manager exists
+	bench.Run( "heap, literal log text", false );
+
+	Msg::CreatePool();
+	bench.Run( "pool, literal log text", false );
+	bench.Run( "pool, built log text", true );
+	printf( "  pool misses: %u\n", Msg::GetPoolMisses() );
+
+	// The driver is left for the process exit to clean up, so that it does
+	// not try to save a configuration it never loaded.
+	return 0;
+}
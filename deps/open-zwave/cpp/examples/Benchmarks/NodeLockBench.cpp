@@ -0,0 +1,246 @@
+//-----------------------------------------------------------------------------
+//
+//	NodeLockBench.cpp
+//
+//	Measures the contention for the driver's node lock between the driver
+//	thread and an application thread which reads values, in the two ways
+//	the node add-on has delivered value notifications:
+//
+//	getters:   the application thread makes the seven Manager calls the
+//	           add-on needs for each value (label, units, read only, write
+//	           only, min, max and the value), each taking the node lock.
+//	snapshot:  the driver thread makes those calls in its watcher callback,
+//	           while it already holds the lock, and the application thread
+//	           only copies the result.
+//
+//	The driver thread holds the lock for a while and then leaves it for a
+//	while, as it does when handling frames from the controller.  The
+//	driver is never started and no Z-Wave hardware is needed.
+//
+//	Copyright (c) 2010 Mal Lansell <mal@openzwave.com>
+//
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "Defs.h"
+#include "Options.h"
+#include "Manager.h"
+#include "Driver.h"
+#include "Node.h"
+#include "value_classes/ValueID.h"
+
+using namespace OpenZWave;
+
+static uint32 const c_homeId = 0x01020304;
+static uint8 const c_nodeId = 5;
+static double const c_runNs = 500000000;	// How long each way is run for
+static double const c_holdNs = 20000;		// How long the driver thread holds the lock each time
+static double const c_idleNs = 20000;		// and how long it leaves it
+
+//-----------------------------------------------------------------------------
+// <Now>
+// Monotonic time in nanoseconds
+//-----------------------------------------------------------------------------
+static double Now
+(
+)
+{
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+//-----------------------------------------------------------------------------
+// <Spin>
+// Keep the thread busy for a while
+//-----------------------------------------------------------------------------
+static void Spin
+(
+	double const _ns
+)
+{
+	double end = Now() + _ns;
+	while( Now() < end )
+	{
+	}
+}
+
+namespace OpenZWave
+{
+	class DriverBench
+	{
+	public:
+		struct Snapshot
+		{
+			char	m_label[64];
+			char	m_units[32];
+			bool	m_readOnly;
+			bool	m_writeOnly;
+			int32	m_min;
+			int32	m_max;
+			uint8	m_value;
+		};
+
+		DriverBench():
+			m_driver( new Driver( "/dev/null", Driver::ControllerInterface_Serial ) ),
+			m_valueId( c_homeId, c_nodeId, ValueID::ValueGenre_User, 0x26, 1, 0, ValueID::ValueType_Byte ),
+			m_snapshotMode( false ),
+			m_stop( false ),
+			m_lockWaitTotal( 0 ),
+			m_lockWaitMax( 0 ),
+			m_locks( 0 )
+		{
+			// Make the driver and one node with one value known to the Manager
+			m_driver->m_homeId = c_homeId;
+			Manager::Get()->m_readyDrivers[c_homeId] = m_driver;
+			Node* node = new Node( c_homeId, c_nodeId );
+			m_driver->m_nodes[c_nodeId] = node;
+			node->CreateValueByte( ValueID::ValueGenre_User, 0x26, 1, 0, "Level", "%", false, false, 42, 0 );
+			TakeSnapshot( &m_record );
+		}
+
+		//-----------------------------------------------------------------------------
+		// <DriverBench::Run>
+		// Read values for c_runNs while the driver thread works, and report
+		//-----------------------------------------------------------------------------
+		void Run
+		(
+			char const* _name,
+			bool const _snapshotMode
+		)
+		{
+			m_snapshotMode = _snapshotMode;
+			m_stop = false;
+			m_lockWaitTotal = 0;
+			m_lockWaitMax = 0;
+			m_locks = 0;
+
+			pthread_t driverThread;
+			pthread_create( &driverThread, NULL, DriverThreadProc, this );
+
+			Snapshot snapshot;
+			uint32 values = 0;
+			double start = Now();
+			double elapsed = 0;
+			while( elapsed < c_runNs )
+			{
+				if( m_snapshotMode )
+				{
+					// Reading a record which the driver thread has queued
+					memcpy( &snapshot, &m_record, sizeof(snapshot) );
+				}
+				else
+				{
+					TakeSnapshot( &snapshot );
+				}
+				++values;
+				elapsed = Now() - start;
+			}
+
+			m_stop = true;
+			pthread_join( driverThread, NULL );
+
+			printf( "  %-9s application thread %7.0f ns/value   driver thread lock wait: average %6.0f ns, max %7.0f ns\n",
+				_name, elapsed / values, m_lockWaitTotal / m_locks, m_lockWaitMax );
+		}
+
+	private:
+		//-----------------------------------------------------------------------------
+		// <DriverBench::TakeSnapshot>
+		// The Manager calls the add-on makes for a byte value
+		//-----------------------------------------------------------------------------
+		void TakeSnapshot
+		(
+			Snapshot* _snapshot
+		)
+		{
+			Manager* mgr = Manager::Get();
+			snprintf( _snapshot->m_label, sizeof(_snapshot->m_label), "%s", mgr->GetValueLabel( m_valueId ).c_str() );
+			snprintf( _snapshot->m_units, sizeof(_snapshot->m_units), "%s", mgr->GetValueUnits( m_valueId ).c_str() );
+			_snapshot->m_readOnly = mgr->IsValueReadOnly( m_valueId );
+			_snapshot->m_writeOnly = mgr->IsValueWriteOnly( m_valueId );
+			_snapshot->m_min = mgr->GetValueMin( m_valueId );
+			_snapshot->m_max = mgr->GetValueMax( m_valueId );
+			mgr->GetValueAsByte( m_valueId, &_snapshot->m_value );
+		}
+
+		//-----------------------------------------------------------------------------
+		// <DriverBench::DriverThreadProc>
+		// Take the node lock, work, and let it go, until told to stop
+		//-----------------------------------------------------------------------------
+		static void* DriverThreadProc
+		(
+			void* _context
+		)
+		{
+			DriverBench* bench = static_cast<DriverBench*>( _context );
+			while( !bench->m_stop )
+			{
+				double start = Now();
+				bench->m_driver->LockNodes();
+				double wait = Now() - start;
+				bench->m_lockWaitTotal += wait;
+				bench->m_lockWaitMax = ( wait > bench->m_lockWaitMax ) ? wait : bench->m_lockWaitMax;
+				bench->m_locks++;
+
+				Spin( c_holdNs );
+				if( bench->m_snapshotMode )
+				{
+					// The watcher callback copies the value for the application
+					bench->TakeSnapshot( &bench->m_snapshot );
+				}
+				bench->m_driver->ReleaseNodes();
+
+				Spin( c_idleNs );
+			}
+			return NULL;
+		}
+
+		Driver*		m_driver;
+		ValueID		m_valueId;
+		Snapshot	m_snapshot;		// Written by the driver thread
+		Snapshot	m_record;		// Read by the application thread
+		bool		m_snapshotMode;
+		volatile bool	m_stop;
+		double		m_lockWaitTotal;
+		double		m_lockWaitMax;
+		uint32		m_locks;
+	};
+}
+
+int main( int argc, char* argv[] )
+{
+	Options::Create( "./", "./", "--Logging false --SaveConfiguration false" );
+	Options::Get()->Lock();
+	Manager::Create();
+
+	DriverBench bench;
+
+	printf( "NodeLockBench: driver thread holds the node lock %.0fus in every %.0fus\n", c_holdNs / 1000, ( c_holdNs + c_idleNs ) / 1000 );
+	bench.Run( "getters", false );
+	bench.Run( "snapshot", true );
+
+	// The Manager and driver are left for the process exit to clean up
+	return 0;
+}
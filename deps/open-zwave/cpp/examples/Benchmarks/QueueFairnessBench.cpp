@@ -0,0 +1,155 @@
+//-----------------------------------------------------------------------------
+//
+//	QueueFairnessBench.cpp
+//
+//	Compares how long messages wait in one of the driver's send queues
+//	when one node has a long backlog, served first in first out (as the
+//	queues were) and served round-robin per node (Driver::SendQueue).
+//
+//	Time is counted in frames: one item leaves the queue per frame.  At the
+//	start, one node queues a backlog, as for a configuration dump or a full
+//	refresh.  Every few frames, one of the other nodes queues a single
+//	message, as for a switch being set from the user interface.
+//
+//	Copyright (c) 2010 Mal Lansell <mal@openzwave.com>
+//
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <list>
+#include <deque>
+#include "Defs.h"
+#include "Driver.h"
+
+using namespace OpenZWave;
+
+static uint8 const c_busyNode = 2;
+static uint32 const c_backlog = 200;		// Messages queued for the busy node at the start
+static uint8 const c_firstNode = 3;		// The other nodes queue one message at a time
+static uint8 const c_numNodes = 20;
+static uint32 const c_spacing = 5;		// Frames between messages from the other nodes
+static uint32 const c_frames = 400;		// Frames over which the other nodes queue messages
+
+namespace OpenZWave
+{
+	class DriverBench
+	{
+	public:
+		//-----------------------------------------------------------------------------
+		// <DriverBench::Compare>
+		// Run the arrivals through a plain list and through a SendQueue
+		//-----------------------------------------------------------------------------
+		static void Compare
+		(
+		)
+		{
+			list<Driver::MsgQueueItem> fifo;
+			Run( "FIFO", fifo );
+
+			Driver::SendQueue roundRobin;
+			Run( "round-robin", roundRobin );
+		}
+
+	private:
+		//-----------------------------------------------------------------------------
+		// <DriverBench::Run>
+		// Play the same arrivals through a queue and report the waits
+		//-----------------------------------------------------------------------------
+		template<class Q>
+		static void Run
+		(
+			char const* _name,
+			Q& _queue
+		)
+		{
+			std::deque<uint32> queued[256];		// When each waiting item was queued, per node
+			uint64 busyTotal = 0, busyMax = 0, busyCount = 0;
+			uint64 otherTotal = 0, otherMax = 0, otherCount = 0;
+
+			for( uint32 i=0; i<c_backlog; ++i )
+			{
+				Push( _queue, queued, c_busyNode, 0 );
+			}
+
+			uint32 frame = 0;
+			uint8 next = c_firstNode;
+			while( frame < c_frames || !_queue.empty() )
+			{
+				if( frame < c_frames && ( frame % c_spacing ) == 0 )
+				{
+					Push( _queue, queued, next, frame );
+					next = ( next + 1 < c_firstNode + c_numNodes ) ? next + 1 : c_firstNode;
+				}
+
+				if( !_queue.empty() )
+				{
+					uint8 nodeId = _queue.front().m_nodeId;
+					_queue.pop_front();
+					uint64 wait = frame - queued[nodeId].front();
+					queued[nodeId].pop_front();
+					if( nodeId == c_busyNode )
+					{
+						busyTotal += wait;
+						busyCount++;
+						busyMax = ( wait > busyMax ) ? wait : busyMax;
+					}
+					else
+					{
+						otherTotal += wait;
+						otherCount++;
+						otherMax = ( wait > otherMax ) ? wait : otherMax;
+					}
+				}
+				++frame;
+			}
+
+			printf( "  %-12s other nodes: average %6.1f max %4u frames   busy node: average %6.1f max %4u frames   (%u frames)\n",
+				_name, (double)otherTotal / otherCount, (uint32)otherMax, (double)busyTotal / busyCount, (uint32)busyMax, frame );
+		}
+
+		//-----------------------------------------------------------------------------
+		// <DriverBench::Push>
+		// Queue an item for a node, and note when it was queued
+		//-----------------------------------------------------------------------------
+		template<class Q>
+		static void Push
+		(
+			Q& _queue,
+			std::deque<uint32>* _queued,
+			uint8 const _nodeId,
+			uint32 const _frame
+		)
+		{
+			Driver::MsgQueueItem item;
+			item.m_command = Driver::MsgQueueCmd_QueryStageComplete;
+			item.m_nodeId = _nodeId;
+			_queue.push_back( item );
+			_queued[_nodeId].push_back( _frame );
+		}
+	};
+}
+
+int main( int argc, char* argv[] )
+{
+	printf( "QueueFairnessBench: backlog of %u for one node, one message every %u frames from %u other nodes\n", c_backlog, c_spacing, c_numNodes );
+	DriverBench::Compare();
+	return 0;
+}
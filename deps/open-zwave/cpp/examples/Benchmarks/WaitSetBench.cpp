@@ -0,0 +1,146 @@
+//-----------------------------------------------------------------------------
+//
+//	WaitSetBench.cpp
+//
+//	Measures the cost of one pass of a wait loop like the one in
+//	Driver::DriverThreadProc, using Wait::Multiple and then a WaitSet.
+//
+//	Twelve events are waited on, as in the driver thread.  Each pass sets
+//	the tenth event (where the send queue sits), waits, and resets it, so
+//	the wait never blocks and only the overhead of the wait is measured.
+//
+//	Copyright (c) 2010 Mal Lansell <mal@openzwave.com>
+//
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "Defs.h"
+#include "platform/Event.h"
+#include "platform/Wait.h"
+#include "platform/WaitSet.h"
+
+using namespace OpenZWave;
+
+static uint32 const c_numObjects = 12;
+static uint32 const c_signalled = 9;
+static uint32 const c_passes = 200000;
+
+//-----------------------------------------------------------------------------
+// <Now>
+// Monotonic time in nanoseconds
+//-----------------------------------------------------------------------------
+static double Now
+(
+)
+{
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+//-----------------------------------------------------------------------------
+// <BenchMultiple>
+// Time c_passes set/wait/reset passes using Wait::Multiple
+//-----------------------------------------------------------------------------
+static double BenchMultiple
+(
+	Event** _events
+)
+{
+	Wait* objects[c_numObjects];
+	for( uint32 i=0; i<c_numObjects; ++i )
+	{
+		objects[i] = _events[i];
+	}
+
+	double start = Now();
+	for( uint32 i=0; i<c_passes; ++i )
+	{
+		_events[c_signalled]->Set();
+		if( Wait::Multiple( objects, c_numObjects ) != (int32)c_signalled )
+		{
+			fprintf( stderr, "Wait::Multiple returned the wrong object\n" );
+			exit( 1 );
+		}
+		_events[c_signalled]->Reset();
+	}
+	return ( Now() - start ) / c_passes;
+}
+
+//-----------------------------------------------------------------------------
+// <BenchWaitSet>
+// Time c_passes set/wait/reset passes using a WaitSet
+//-----------------------------------------------------------------------------
+static double BenchWaitSet
+(
+	Event** _events
+)
+{
+	Wait* objects[c_numObjects];
+	for( uint32 i=0; i<c_numObjects; ++i )
+	{
+		objects[i] = _events[i];
+	}
+
+	// Registration happens once, outside the timed loop, as in the driver thread
+	WaitSet waitSet( objects, c_numObjects );
+
+	double start = Now();
+	for( uint32 i=0; i<c_passes; ++i )
+	{
+		_events[c_signalled]->Set();
+		if( waitSet.Wait( c_numObjects ) != (int32)c_signalled )
+		{
+			fprintf( stderr, "WaitSet::Wait returned the wrong object\n" );
+			exit( 1 );
+		}
+		_events[c_signalled]->Reset();
+	}
+	return ( Now() - start ) / c_passes;
+}
+
+int main( int argc, char* argv[] )
+{
+	Event* events[c_numObjects];
+	for( uint32 i=0; i<c_numObjects; ++i )
+	{
+		events[i] = new Event();
+	}
+
+	// Warm up both paths before timing them
+	BenchMultiple( events );
+	BenchWaitSet( events );
+
+	double multiple = BenchMultiple( events );
+	double waitSet = BenchWaitSet( events );
+
+	printf( "WaitSetBench: %u objects, %u passes\n", c_numObjects, c_passes );
+	printf( "  Wait::Multiple  %8.0f ns/pass\n", multiple );
+	printf( "  WaitSet::Wait   %8.0f ns/pass\n", waitSet );
+
+	for( uint32 i=0; i<c_numObjects; ++i )
+	{
+		events[i]->Release();
+	}
+	return 0;
+}
@@ -179,6 +179,10 @@ namespace OpenZWave
 #define ACK_TIMEOUT	1000		// How long to wait for an ACK
 #define BYTE_TIMEOUT	150
 #define RETRY_TIMEOUT	40000		// Retry send after 40 seconds
+#define RETRY_TIMEOUT_MIN	2000	// Shortest retry timeout derived from a node's round trip times
+#define DEAD_NODE_THRESHOLD	3	// Failures in a row before a node is presumed dead
+#define DEAD_NODE_PROBE_INTERVAL	10000	// Wait before the first probe of a dead node, doubled for each one after
+#define FRESH_POLL_PERCENT	50	// Skip a poll if the value was refreshed within this much of its poll interval
 
 #define SOF												0x01
 #define ACK												0x06
@@ -40,6 +40,7 @@
 #include "platform/Thread.h"
 #include "platform/Log.h"
 #include "platform/TimeStamp.h"
+#include "platform/WaitSet.h"
 
 #include "command_classes/CommandClasses.h"
 #include "command_classes/ApplicationStatus.h"
@@ -79,6 +80,9 @@ using namespace OpenZWave;
 //
 uint32 const c_configVersion = 3;
 
+// The longest poll interval, in milliseconds, that the poll thread can wait for
+static uint32 const c_maxPollInterval = 0x7fffffff;
+
 static char const* c_libraryTypeNames[] =
 {
 	"Unknown",			// library type 0
@@ -138,6 +142,8 @@ Driver::Driver
 	m_driverThread( new Thread( "driver" ) ),
 	m_exit( false ),
 	m_init( false ),
+	m_reconnecting( false ),
+	m_reconnectEvent( new Event() ),
 	m_awakeNodesQueried( false ),
 	m_allNodesQueried( false ),
 	m_notifytransactions( false ),
@@ -166,13 +172,24 @@ Driver::Driver
 	m_pollMutex( new Mutex() ),
 	m_pollInterval( 0 ),
 	m_bIntervalBetweenPolls( false ),				// if set to true (via SetPollInterval), the pollInterval will be interspersed between each poll (so a much smaller m_pollInterval like 100, 500, or 1,000 may be appropriate)
+	m_pollEvent( new Event() ),
+	m_pollIdleEvent( new Event() ),
+	m_freshPollPercent( FRESH_POLL_PERCENT ),
 	m_currentControllerCommand( NULL ),
 	m_SUCNodeId( 0 ),
 	m_controllerResetEvent( NULL ),
 	m_sendMutex( new Mutex() ),
+	m_openCircuits( 0 ),
+	m_deadNodeThreshold( DEAD_NODE_THRESHOLD ),
+	m_deadNodeProbeInterval( DEAD_NODE_PROBE_INTERVAL ),
 	m_currentMsg( NULL ),
 	m_virtualNeighborsReceived( false ),
 	m_notificationsEvent( new Event() ),
+	m_frameReadTime( 0 ),
+	m_frameTime( 0 ),
+	m_inFrame( false ),
+	m_rxLength( 0 ),
+	m_rxPartialTime( 0 ),
 	m_SOFCnt( 0 ),
 	m_ACKWaiting( 0 ),
 	m_readAborts( 0 ),
@@ -184,6 +201,13 @@ Driver::Driver
 	m_ACKCnt( 0 ),
 	m_OOFCnt( 0 ),
 	m_dropped( 0 ),
+	m_expired( 0 ),
+	m_coalesced( 0 ),
+	m_suppressed( 0 ),
+	m_savedBytes( 0 ),
+	m_tripped( 0 ),
+	m_parked( 0 ),
+	m_skippedPolls( 0 ),
 	m_retries( 0 ),
 	m_callbacks( 0 ),
 	m_badroutes( 0 ),
@@ -223,6 +247,14 @@ Driver::Driver
 	Options::Get()->GetOptionAsBool( "NotifyTransactions", &m_notifytransactions );
 	Options::Get()->GetOptionAsInt( "PollInterval", &m_pollInterval );
 	Options::Get()->GetOptionAsBool( "IntervalBetweenPolls", &m_bIntervalBetweenPolls );
+	Options::Get()->GetOptionAsInt( "FreshPollPercent", &m_freshPollPercent );
+	if( m_freshPollPercent > 90 )
+	{
+		// Any higher and the reply to a value's own poll would count as fresh next time round
+		m_freshPollPercent = 90;
+	}
+	Options::Get()->GetOptionAsInt( "DeadNodeThreshold", &m_deadNodeThreshold );
+	Options::Get()->GetOptionAsInt( "DeadNodeProbeInterval", &m_deadNodeProbeInterval );
 }
 
 //-----------------------------------------------------------------------------
@@ -265,6 +297,9 @@ Driver::~Driver
 	m_driverThread->Stop();
 	m_driverThread->Release();
 
+	m_pollEvent->Release();
+	m_pollIdleEvent->Release();
+
 	m_sendMutex->Release();
 
 	m_controller->Close();
@@ -312,6 +347,17 @@ Driver::~Driver
 
 		m_queueEvent[i]->Release();
 	}
+
+	// And anything held back for nodes which were not answering
+	while( !m_parkedQueue.empty() )
+	{
+		MsgQueueItem const& item = m_parkedQueue.front();
+		if( MsgQueueCmd_SendMsg == item.m_command )
+		{
+			delete item.m_msg;
+		}
+		m_parkedQueue.pop_front();
+	}
 	/* Doing our Notification Call back here in the destructor is just asking for trouble
 	 * as there is a good chance that the application will do some sort of GetDriver() supported
 	 * method on the Manager Class, which by this time, most of the OZW Classes associated with the
@@ -329,6 +375,7 @@ Driver::~Driver
 		}
 	}
 	m_notificationsEvent->Release();
+	m_reconnectEvent->Release();
 	m_nodeMutex->Release();
 
 	delete m_controllerReplication;
@@ -378,34 +425,72 @@ void Driver::DriverThreadProc
 		if( Init( attempts ) )
 		{
 			// Driver has been initialised
-			Wait* waitObjects[11];
+			Wait* waitObjects[12];
 			waitObjects[0] = _exitEvent;				// Thread must exit.
 			waitObjects[1] = m_notificationsEvent;			// Notifications waiting to be sent.
 			waitObjects[2] = m_controller;				// Controller has received data.
-			waitObjects[3] = m_queueEvent[MsgQueue_Command];	// A controller command is in progress.
-			waitObjects[4] = m_queueEvent[MsgQueue_Security];	// Security Related Commands (As they have a timeout)
-			waitObjects[5] = m_queueEvent[MsgQueue_NoOp];		// Send device probes and diagnostics messages
-			waitObjects[6] = m_queueEvent[MsgQueue_Controller];	// A multi-part controller command is in progress
-			waitObjects[7] = m_queueEvent[MsgQueue_WakeUp];		// A node has woken. Pending messages should be sent.
-			waitObjects[8] = m_queueEvent[MsgQueue_Send];		// Ordinary requests to be sent.
-			waitObjects[9] = m_queueEvent[MsgQueue_Query];		// Node queries are pending.
-			waitObjects[10] = m_queueEvent[MsgQueue_Poll];		// Poll request is waiting.
+			waitObjects[3] = m_reconnectEvent;			// Controller must be reopened.
+			waitObjects[4] = m_queueEvent[MsgQueue_Command];	// A controller command is in progress.
+			waitObjects[5] = m_queueEvent[MsgQueue_Security];	// Security Related Commands (As they have a timeout)
+			waitObjects[6] = m_queueEvent[MsgQueue_NoOp];		// Send device probes and diagnostics messages
+			waitObjects[7] = m_queueEvent[MsgQueue_Controller];	// A multi-part controller command is in progress
+			waitObjects[8] = m_queueEvent[MsgQueue_WakeUp];		// A node has woken. Pending messages should be sent.
+			waitObjects[9] = m_queueEvent[MsgQueue_Send];		// Ordinary requests to be sent.
+			waitObjects[10] = m_queueEvent[MsgQueue_Query];		// Node queries are pending.
+			waitObjects[11] = m_queueEvent[MsgQueue_Poll];		// Poll request is waiting.
+
+			// Register with the objects once, rather than on every wait
+			WaitSet waitSet( waitObjects, 12 );
 
 			TimeStamp retryTimeStamp;
 			int retryTimeout = RETRY_TIMEOUT;
 			Options::Get()->GetOptionAsInt( "RetryTimeout", &retryTimeout );
+			int minRetryTimeout = RETRY_TIMEOUT_MIN;
+			Options::Get()->GetOptionAsInt( "RetryTimeoutMin", &minRetryTimeout );
+			if( minRetryTimeout > retryTimeout )
+			{
+				minRetryTimeout = retryTimeout;
+			}
+			bool reconnect = false;
+			bool timingCallback = false;
 
-			while( true )
+			while( !reconnect )
 			{
 				Log::Write( LogLevel_StreamDetail, "      Top of DriverThreadProc loop." );
-				uint32 count = 11;
+
+				// The controller can take a long time to deliver a frame, so the
+				// whole retry timeout is allowed for the callback.  Once it has
+				// come, only the report is left to wait for, and that is timed
+				// from what the node has done before.
+				if( timingCallback && !m_expectedCallbackId )
+				{
+					timingCallback = false;
+					if( m_expectedReply )
+					{
+						retryTimeStamp.SetTime( GetRetryTimeout( minRetryTimeout, retryTimeout ) );
+					}
+				}
+
+				// Nodes which are presumed dead are probed in the background
+				if( m_openCircuits != 0 && m_probeTimeStamp.TimeRemaining() <= 0 )
+				{
+					SendProbes();
+				}
+
+				uint32 count = 12;
 				int32 timeout = Wait::Timeout_Infinite;
 
+				// Let the poll thread know when there is nothing else to send
+				if( !( m_waitingForAck || m_expectedCallbackId || m_expectedReply ) && m_currentControllerCommand == NULL && IsPollIdle() )
+				{
+					m_pollIdleEvent->Set();
+				}
+
 				// If we're waiting for a message to complete, we can only
-				// handle incoming data, notifications and exit events.
+				// handle incoming data, notifications, reconnect and exit events.
 				if( m_waitingForAck || m_expectedCallbackId || m_expectedReply )
 				{
-					count = 3;
+					count = 4;
 					timeout = m_waitingForAck ? ACK_TIMEOUT : retryTimeStamp.TimeRemaining();
 					if( timeout < 0 )
 					{
@@ -414,20 +499,36 @@ void Driver::DriverThreadProc
 				}
 				else if( m_currentControllerCommand != NULL )
 				{
-					count = 7;
+					count = 8;
 				}
 				else
 				{
 					Log::QueueClear();							// clear the log queue when starting a new message
 				}
 
+				// Wake up in time for the next probe
+				if( count != 4 && m_openCircuits != 0 )
+				{
+					timeout = m_probeTimeStamp.TimeRemaining();
+					if( timeout < 0 )
+					{
+						timeout = 0;
+					}
+				}
+
 				// Wait for something to do
-				int32 res = Wait::Multiple( waitObjects, count, timeout );
+				int32 res = waitSet.Wait( count, timeout );
 
 				switch( res )
 				{
 					case -1:
 					{
+						if( count != 4 )
+						{
+							// Only a probe is due, and that is dealt with at the top of the loop
+							break;
+						}
+
 						// Wait has timed out - time to resend
 						if( m_currentMsg != NULL )
 						{
@@ -435,10 +536,22 @@ void Driver::DriverThreadProc
 							notification->SetHomeAndNodeIds( m_homeId, m_currentMsg->GetTargetNodeId() );
 							notification->SetNotification( Notification::Code_Timeout );
 							QueueNotification( notification );
+
+							// Back off, in case the route has got slower
+							Node* node = m_waitingForAck ? NULL : GetNodeUnsafe( m_currentMsg->GetTargetNodeId() );
+							if( node != NULL )
+							{
+								if( node->m_retryBackoff < 6 )
+								{
+									node->m_retryBackoff++;
+								}
+								RecordNodeFailure( node );
+							}
 						}
 						if( WriteMsg( "Wait Timeout" ) )
 						{
-							retryTimeStamp.SetTime( retryTimeout );
+							timingCallback = ( m_expectedCallbackId != 0 );
+							retryTimeStamp.SetTime( timingCallback ? retryTimeout : GetRetryTimeout( minRetryTimeout, retryTimeout ) );
 						}
 						break;
 					}
@@ -459,24 +572,39 @@ void Driver::DriverThreadProc
 						ReadMsg();
 						break;
 					}
+					case 3:
+					{
+						// A reconnect has been requested
+						m_reconnectEvent->Reset();
+						reconnect = true;
+						break;
+					}
 					default:
 					{
 						// All the other events are sending message queue items
-						if( WriteNextMsg( (MsgQueue)(res-3) ) )
+						if( WriteNextMsg( (MsgQueue)(res-4) ) )
 						{
-							retryTimeStamp.SetTime( retryTimeout );
+							timingCallback = ( m_expectedCallbackId != 0 );
+							retryTimeStamp.SetTime( timingCallback ? retryTimeout : GetRetryTimeout( minRetryTimeout, retryTimeout ) );
 						}
 						break;
 					}
 				}
 			}
+
+			// Reopen the controller straight away, keeping all of our nodes
+			CloseController();
+			attempts = 0;
+			continue;
 		}
 
 		++attempts;
 
+		// Once the driver has been ready we never give up on it, as
+		// that would throw away all of the node information.
 		uint32 maxAttempts = 0;
 		Options::Get()->GetOptionAsInt("DriverMaxAttempts", (int32 *)&maxAttempts);
-		if( maxAttempts && (attempts >= maxAttempts) )
+		if( maxAttempts && (attempts >= maxAttempts) && !m_init )
 		{
 			Manager::Get()->Manager::SetDriverReady(this, false);
 			NotifyWatchers();
@@ -545,6 +673,91 @@ bool Driver::Init
 	return true;
 }
 
+//-----------------------------------------------------------------------------
+// <Driver::RequestReconnect>
+// Ask the driver thread to reopen the controller
+//-----------------------------------------------------------------------------
+void Driver::RequestReconnect
+(
+)
+{
+	Log::Write( LogLevel_Info, "Reconnect requested for controller %s", m_controllerPath.c_str() );
+	m_reconnectEvent->Set();
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::CloseController>
+// Close the controller, ready for it to be reopened by Init
+//-----------------------------------------------------------------------------
+void Driver::CloseController
+(
+)
+{
+	Log::Write( LogLevel_Info, "  Closing controller %s", m_controllerPath.c_str() );
+
+	m_pollThread->Stop();
+	m_controller->Close();
+	m_controller->Purge();
+	m_rxLength = 0;
+
+	// Whatever was in flight is lost, so treat it as dropped.  Anything
+	// still queued is sent once the controller is back.
+	if( m_currentMsg != NULL )
+	{
+		RemoveCurrentMsg();
+		m_dropped++;
+	}
+	else
+	{
+		m_expectedCallbackId = 0;
+		m_expectedCommandClassId = 0;
+		m_expectedNodeId = 0;
+		m_expectedReply = 0;
+		m_waitingForAck = false;
+	}
+
+	// A controller command cannot carry on over a new connection, so fail
+	// it and take it off the controller queue, as if it had finished.
+	if( m_currentControllerCommand != NULL )
+	{
+		UpdateControllerState( ControllerState_Failed );
+
+		bool queued = false;
+		m_sendMutex->Lock();
+		for( int32 nodeId=0; nodeId<256 && !queued; ++nodeId )
+		{
+			list<MsgQueueItem>& items = m_msgQueue[MsgQueue_Controller].GetNodeItems( (uint8)nodeId );
+			for( list<MsgQueueItem>::iterator it = items.begin(); it != items.end(); ++it )
+			{
+				if( MsgQueueCmd_Controller == it->m_command && m_currentControllerCommand == it->m_cci )
+				{
+					m_msgQueue[MsgQueue_Controller].Erase( (uint8)nodeId, it );
+					queued = true;
+					break;
+				}
+			}
+		}
+		if( m_msgQueue[MsgQueue_Controller].empty() )
+		{
+			m_queueEvent[MsgQueue_Controller]->Reset();
+		}
+		m_sendMutex->Unlock();
+
+		if( m_currentControllerCommand->m_controllerCallback )
+		{
+			m_currentControllerCommand->m_controllerCallback( m_currentControllerCommand->m_controllerState, m_currentControllerCommand->m_controllerReturnError, m_currentControllerCommand->m_controllerCallbackContext );
+		}
+		if( queued )
+		{
+			delete m_currentControllerCommand;
+		}
+		m_currentControllerCommand = NULL;
+	}
+
+	// Only skip the reset if we have nodes to keep.
+	m_reconnecting = m_init;
+}
+
 //-----------------------------------------------------------------------------
 // <Driver::RemoveQueues>
 // Clean up any messages to a node
@@ -562,8 +775,9 @@ void Driver::RemoveQueues
 	// Clear the send Queue
 	for( int32 i=0; i<MsgQueue_Count; ++i )
 	{
-		list<MsgQueueItem>::iterator it = m_msgQueue[i].begin();
-		while( it != m_msgQueue[i].end() )
+		list<MsgQueueItem>& items = m_msgQueue[i].GetNodeItems( _nodeId );
+		list<MsgQueueItem>::iterator it = items.begin();
+		while( it != items.end() )
 		{
 			bool remove = false;
 			MsgQueueItem const& item = *it;
@@ -583,7 +797,7 @@ void Driver::RemoveQueues
 			}
 			if( remove )
 			{
-				it = m_msgQueue[i].erase( it );
+				it = m_msgQueue[i].Erase( _nodeId, it );
 			}
 			else
 			{
@@ -595,6 +809,16 @@ void Driver::RemoveQueues
 			m_queueEvent[i]->Reset();
 		}
 	}
+
+	list<MsgQueueItem>& parked = m_parkedQueue.GetNodeItems( _nodeId );
+	while( !parked.empty() )
+	{
+		if( MsgQueueCmd_SendMsg == parked.front().m_command )
+		{
+			delete parked.front().m_msg;
+		}
+		m_parkedQueue.Erase( _nodeId, parked.begin() );
+	}
 }
 
 //-----------------------------------------------------------------------------
@@ -904,10 +1128,18 @@ void Driver::SendQueryStageComplete
 		}
 
 		// Non-sleeping node
-		Log::Write( LogLevel_Detail, node->GetNodeId(), "Queuing (%s) Query Stage Complete (%s)", c_sendQueueNames[MsgQueue_Query], node->GetQueryStageName( _stage ).c_str() );
 		m_sendMutex->Lock();
-		m_msgQueue[MsgQueue_Query].push_back( item );
-		m_queueEvent[MsgQueue_Query]->Set();
+		if( node->m_circuitOpen )
+		{
+			// Keep it behind the messages held back for the node
+			ParkMsg( item, MsgQueue_Query );
+		}
+		else
+		{
+			Log::Write( LogLevel_Detail, node->GetNodeId(), "Queuing (%s) Query Stage Complete (%s)", c_sendQueueNames[MsgQueue_Query], node->GetQueryStageName( _stage ).c_str() );
+			m_msgQueue[MsgQueue_Query].push_back( item );
+			m_queueEvent[MsgQueue_Query]->Set();
+		}
 		m_sendMutex->Unlock();
 
 		ReleaseNodes();
@@ -931,7 +1163,8 @@ void Driver::RetryQueryStageComplete
 
 	m_sendMutex->Lock();
 
-	for( list<MsgQueueItem>::iterator it = m_msgQueue[MsgQueue_Query].begin(); it != m_msgQueue[MsgQueue_Query].end(); ++it )
+	list<MsgQueueItem>& items = m_msgQueue[MsgQueue_Query].GetNodeItems( _nodeId );
+	for( list<MsgQueueItem>::iterator it = items.begin(); it != items.end(); ++it )
 	{
 		if( *it == item )
 		{
@@ -990,6 +1223,16 @@ void Driver::SendMsg
 			}
 		}
 
+		// If the node has stopped answering, the message waits until it does
+		if( node->m_circuitOpen && !_msg->IsNoOperation() )
+		{
+			m_sendMutex->Lock();
+			ParkMsg( item, _queue );
+			m_sendMutex->Unlock();
+			ReleaseNodes();
+			return;
+		}
+
 		/* if the node Supports the Security Class - check if this message is meant to be encapsulated */
 		if ( Security* security = static_cast<Security *>( node->GetCommandClass(Security::StaticGetCommandClassId() ) ) )
 		{
@@ -1005,13 +1248,93 @@ void Driver::SendMsg
 		ReleaseNodes();
 	}
 
-	Log::Write( LogLevel_Detail, GetNodeNumber( _msg ), "Queuing (%s) %s", c_sendQueueNames[_queue], _msg->GetAsString().c_str() );
+	// A poll still waiting after a whole poll cycle is stale, the next
+	// cycle will ask again.
+	if( _queue == MsgQueue_Poll && !_msg->HasDeadline() && !m_bIntervalBetweenPolls && m_pollInterval > 0 )
+	{
+		_msg->SetDeadline( m_pollInterval );
+	}
+
 	m_sendMutex->Lock();
+	if( CoalesceMsg( _msg, _queue ) )
+	{
+		m_sendMutex->Unlock();
+		return;
+	}
+	OZW_LOG_CC( LogLevel_Detail, GetNodeNumber( _msg ), _msg->GetSendingCommandClass(), "Queuing (%s) %s", c_sendQueueNames[_queue], _msg->GetAsString().c_str() );
 	m_msgQueue[_queue].push_back( item );
 	m_queueEvent[_queue]->Set();
 	m_sendMutex->Unlock();
 }
 
+//-----------------------------------------------------------------------------
+// <Driver::CoalesceMsg>
+// Look for a queued message which does the same job as a new one.  A Set
+// which leaves the same value as a queued one replaces it, and so does a Get
+// asking for the same report, so that only one of them is sent.  If the
+// queued message would be sent no later than the new one, the new message
+// takes its place in the queue, and its deadline.  Otherwise the queued
+// message is removed and the new one is queued as normal.  Must be called
+// with m_sendMutex held.
+//-----------------------------------------------------------------------------
+bool Driver::CoalesceMsg
+(
+	Msg* _msg,
+	MsgQueue const _queue
+)
+{
+	uint8 nodeId = _msg->GetTargetNodeId();
+
+	for( int32 i=0; i<MsgQueue_Count; ++i )
+	{
+		list<MsgQueueItem>& items = m_msgQueue[i].GetNodeItems( nodeId );
+		for( list<MsgQueueItem>::iterator it = items.begin(); it != items.end(); ++it )
+		{
+			if( MsgQueueCmd_SendMsg != it->m_command )
+			{
+				continue;
+			}
+
+			Msg* pending = it->m_msg;
+			if( _msg->IsSameGet( *pending ) )
+			{
+				OZW_LOG_CC( LogLevel_Detail, nodeId, _msg->GetSendingCommandClass(), "Duplicate of a request already queued (%s), not sending %s", c_sendQueueNames[i], _msg->GetAsString().c_str() );
+				m_suppressed++;
+			}
+			else if( _msg->IsSameSet( *pending ) )
+			{
+				OZW_LOG_CC( LogLevel_Detail, nodeId, _msg->GetSendingCommandClass(), "Replacing a Set already queued (%s) with %s", c_sendQueueNames[i], _msg->GetAsString().c_str() );
+				m_coalesced++;
+			}
+			else
+			{
+				continue;
+			}
+			m_savedBytes += pending->GetLength();
+
+			if( i <= _queue )
+			{
+				// In the queued message's place, it is no more likely to go
+				// stale than that was.  A poll's deadline only applies in
+				// the poll queue.
+				_msg->TakeDeadline( *pending );
+				delete pending;
+				it->m_msg = _msg;
+				return true;
+			}
+			delete pending;
+
+			m_msgQueue[i].Erase( nodeId, it );
+			if( m_msgQueue[i].empty() )
+			{
+				m_queueEvent[i]->Reset();
+			}
+			return false;
+		}
+	}
+	return false;
+}
+
 //-----------------------------------------------------------------------------
 // <Driver::WriteNextMsg>
 // Transmit a queued message to the Z-Wave controller
@@ -1028,15 +1351,37 @@ bool Driver::WriteNextMsg
 
 	if( MsgQueueCmd_SendMsg == item.m_command )
 	{
-		// Send a message
-		m_currentMsg = item.m_msg;
-		m_currentMsgQueueSource = _queue;
 		m_msgQueue[_queue].pop_front();
 		if( m_msgQueue[_queue].empty() )
 		{
 			m_queueEvent[_queue]->Reset();
 		}
 		m_sendMutex->Unlock();
+
+		uint8 nodeId = item.m_msg->GetTargetNodeId();
+		if( item.m_msg->IsExpired() )
+		{
+			Log::Write( LogLevel_Info, nodeId, "Dropping message, deadline passed while queued: %s", item.m_msg->GetAsString().c_str() );
+			delete item.m_msg;
+			m_expired++;
+			return false;
+		}
+
+		// Keep track of how long messages wait to be sent
+		if( Node* node = GetNodeUnsafe( nodeId ) )
+		{
+			uint32 wait = (uint32)( ( TimeStamp::GetMonotonic() - item.m_queuedTime ) / 1000 );
+			node->m_lastQueueWait = wait;
+			node->m_averageQueueWait = node->m_averageQueueWait ? ( node->m_averageQueueWait + wait ) >> 1 : wait;
+			if( wait > node->m_maxQueueWait )
+			{
+				node->m_maxQueueWait = wait;
+			}
+		}
+
+		// Send a message
+		m_currentMsg = item.m_msg;
+		m_currentMsgQueueSource = _queue;
 		return WriteMsg( "WriteNextMsg" );
 	}
 
@@ -1114,6 +1459,147 @@ bool Driver::WriteNextMsg
 	return false;
 }
 
+//-----------------------------------------------------------------------------
+// <Driver::SendQueue::GetItemNodeId>
+// The node a queued item belongs to
+//-----------------------------------------------------------------------------
+uint8 Driver::SendQueue::GetItemNodeId
+(
+	MsgQueueItem const& _item
+)
+{
+	switch( _item.m_command )
+	{
+		case MsgQueueCmd_SendMsg:
+		{
+			return _item.m_msg->GetTargetNodeId();
+		}
+		case MsgQueueCmd_QueryStageComplete:
+		{
+			return _item.m_nodeId;
+		}
+		case MsgQueueCmd_Controller:
+		{
+			return _item.m_cci->m_controllerCommandNode;
+		}
+	}
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::SendQueue::push_back>
+// Add an item to the back of its node's queue
+//-----------------------------------------------------------------------------
+void Driver::SendQueue::push_back
+(
+	MsgQueueItem const& _item
+)
+{
+	uint8 nodeId = GetItemNodeId( _item );
+
+	if( m_nodes[nodeId].empty() )
+	{
+		if( m_freeActive.empty() )
+		{
+			m_active.push_back( nodeId );
+		}
+		else
+		{
+			m_active.splice( m_active.end(), m_freeActive, m_freeActive.begin() );
+			m_active.back() = nodeId;
+		}
+	}
+
+	if( m_freeItems.empty() )
+	{
+		m_nodes[nodeId].push_back( _item );
+	}
+	else
+	{
+		m_nodes[nodeId].splice( m_nodes[nodeId].end(), m_freeItems, m_freeItems.begin() );
+		m_nodes[nodeId].back() = _item;
+	}
+	m_nodes[nodeId].back().m_queuedTime = TimeStamp::GetMonotonic();
+	++m_size;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::SendQueue::pop_front>
+// Remove the front item, and move on to the next node
+//-----------------------------------------------------------------------------
+void Driver::SendQueue::pop_front
+(
+)
+{
+	uint8 nodeId = m_active.front();
+
+	m_freeItems.splice( m_freeItems.begin(), m_nodes[nodeId], m_nodes[nodeId].begin() );
+	--m_size;
+
+	if( m_nodes[nodeId].empty() )
+	{
+		m_freeActive.splice( m_freeActive.begin(), m_active, m_active.begin() );
+	}
+	else
+	{
+		m_active.splice( m_active.end(), m_active, m_active.begin() );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::SendQueue::Erase>
+// Remove an item from a node's queue
+//-----------------------------------------------------------------------------
+list<Driver::MsgQueueItem>::iterator Driver::SendQueue::Erase
+(
+	uint8 const _nodeId,
+	list<MsgQueueItem>::iterator _it
+)
+{
+	list<MsgQueueItem>::iterator next = _it;
+	++next;
+	m_freeItems.splice( m_freeItems.begin(), m_nodes[_nodeId], _it );
+	--m_size;
+
+	if( m_nodes[_nodeId].empty() )
+	{
+		for( list<uint8>::iterator it = m_active.begin(); it != m_active.end(); ++it )
+		{
+			if( *it == _nodeId )
+			{
+				m_freeActive.splice( m_freeActive.begin(), m_active, it );
+				break;
+			}
+		}
+	}
+	return next;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::GetRetryTimeout>
+// How long to wait for the current message to complete before retrying it,
+// based on how quickly its node has been answering
+//-----------------------------------------------------------------------------
+int32 Driver::GetRetryTimeout
+(
+	int32 const _min,
+	int32 const _max
+)
+{
+	if( m_currentMsg == NULL )
+	{
+		return _max;
+	}
+
+	Node* node = GetNodeUnsafe( m_currentMsg->GetTargetNodeId() );
+	if( node == NULL )
+	{
+		return _max;
+	}
+
+	return node->GetRetryTimeout( m_expectedReply == FUNC_ID_APPLICATION_COMMAND_HANDLER, _min, _max );
+}
+
 //-----------------------------------------------------------------------------
 // <Driver::WriteMsg>
 // Transmit the current message to the Z-Wave controller
@@ -1138,6 +1624,13 @@ bool Driver::WriteMsg
 	uint8 attempts = m_currentMsg->GetSendAttempts();
 	uint8 nodeId = m_currentMsg->GetTargetNodeId();
 	Node* node = GetNode( nodeId );
+	if( node != NULL && node->m_circuitOpen && !m_currentMsg->IsNoOperation() && m_currentControllerCommand == NULL )
+	{
+		// The node stopped answering while the message was queued or being sent
+		ParkCurrentMsg();
+		ReleaseNodes();
+		return false;
+	}
 	if( attempts >= m_currentMsg->GetMaxSendAttempts() || (node != NULL && !node->IsNodeAlive() && !m_currentMsg->IsNoOperation() ) )
 	{
 		if( node != NULL && !node->IsNodeAlive() )
@@ -1183,8 +1676,11 @@ bool Driver::WriteMsg
 		}
 	}
 
-	Log::Write( LogLevel_Detail, "" );
-	Log::Write( LogLevel_Info, nodeId, "Sending (%s) message (%sCallback ID=0x%.2x, Expected Reply=0x%.2x) - %s", c_sendQueueNames[m_currentMsgQueueSource], attemptsstr.c_str(), m_expectedCallbackId, m_expectedReply, m_currentMsg->GetAsString().c_str() );
+	if( Log::IsEnabled( LogLevel_Info, nodeId, m_currentMsg->GetSendingCommandClass() ) )
+	{
+		Log::Write( LogLevel_Detail, "" );
+		Log::Write( LogLevel_Info, nodeId, "Sending (%s) message (%sCallback ID=0x%.2x, Expected Reply=0x%.2x) - %s", c_sendQueueNames[m_currentMsgQueueSource], attemptsstr.c_str(), m_expectedCallbackId, m_expectedReply, m_currentMsg->GetAsString().c_str() );
+	}
 
 	m_controller->Write( m_currentMsg->GetBuffer(), m_currentMsg->GetLength() );
 	m_writeCnt++;
@@ -1306,8 +1802,9 @@ bool Driver::MoveMessagesToWakeUpQueue
 					// Now the message queues
 					for( int i=0; i<MsgQueue_Count; ++i )
 					{
-						list<MsgQueueItem>::iterator it = m_msgQueue[i].begin();
-						while( it != m_msgQueue[i].end() )
+						list<MsgQueueItem>& items = m_msgQueue[i].GetNodeItems( _targetNodeId );
+						list<MsgQueueItem>::iterator it = items.begin();
+						while( it != items.end() )
 						{
 							bool remove = false;
 							MsgQueueItem const& item = *it;
@@ -1351,7 +1848,7 @@ bool Driver::MoveMessagesToWakeUpQueue
 
 							if( remove )
 							{
-								it = m_msgQueue[i].erase( it );
+								it = m_msgQueue[i].Erase( _targetNodeId, it );
 							}
 							else
 							{
@@ -1391,6 +1888,291 @@ bool Driver::MoveMessagesToWakeUpQueue
 	return false;
 }
 
+//-----------------------------------------------------------------------------
+// <Driver::RecordNodeFailure>
+// Count a failure to reach a node.  After too many in a row the node is
+// presumed dead, and rather than trying every message for it in turn, they
+// are held back until it answers again.
+//-----------------------------------------------------------------------------
+void Driver::RecordNodeFailure
+(
+	Node* _node
+)
+{
+	if( _node->GetNodeId() == m_nodeId )
+	{
+		return;
+	}
+
+	if( _node->m_errors < 0xff )
+	{
+		++_node->m_errors;
+	}
+
+	if( m_deadNodeThreshold > 0 && _node->m_errors >= m_deadNodeThreshold && !_node->m_circuitOpen )
+	{
+		OpenCircuit( _node );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::OpenCircuit>
+// Take a node's messages out of the send queues until it answers a probe
+//-----------------------------------------------------------------------------
+void Driver::OpenCircuit
+(
+	Node* _node
+)
+{
+	uint8 nodeId = _node->GetNodeId();
+	Log::Write( LogLevel_Warning, nodeId, "WARNING: Node not responding - holding back its messages until it answers again" );
+
+	_node->m_circuitOpen = true;
+	_node->m_probeBackoff = 0;
+	_node->m_nextProbe.SetTime( m_deadNodeProbeInterval );
+	if( m_openCircuits++ == 0 || m_probeTimeStamp.TimeRemaining() > m_deadNodeProbeInterval )
+	{
+		m_probeTimeStamp.SetTime( m_deadNodeProbeInterval );
+	}
+	m_tripped++;
+
+	// The current message is left alone, as whoever is handling it will
+	// park it once they find out the node is not answering.  Controller
+	// commands are left where they are too, as some of them are meant
+	// for dead nodes.
+	m_sendMutex->Lock();
+	for( int i=0; i<MsgQueue_Count; ++i )
+	{
+		list<MsgQueueItem>& items = m_msgQueue[i].GetNodeItems( nodeId );
+		list<MsgQueueItem>::iterator it = items.begin();
+		while( it != items.end() )
+		{
+			MsgQueueItem const& item = *it;
+			if( ( MsgQueueCmd_SendMsg == item.m_command && nodeId == item.m_msg->GetTargetNodeId() ) ||
+			    ( MsgQueueCmd_QueryStageComplete == item.m_command && nodeId == item.m_nodeId ) )
+			{
+				ParkMsg( item, (MsgQueue)i );
+				it = m_msgQueue[i].Erase( nodeId, it );
+			}
+			else
+			{
+				++it;
+			}
+		}
+
+		if( m_msgQueue[i].empty() )
+		{
+			m_queueEvent[i]->Reset();
+		}
+	}
+	m_sendMutex->Unlock();
+
+	if( _node->IsNodeAlive() )
+	{
+		_node->SetNodeAlive( false );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::CloseCircuit>
+// The node has answered, so send everything held back for it.  Returns true
+// if a query stage marker was among them, in which case the node's queries
+// carry on from where they were without being advanced again.
+//-----------------------------------------------------------------------------
+bool Driver::CloseCircuit
+(
+	uint8 const _nodeId
+)
+{
+	Node* node = GetNodeUnsafe( _nodeId );
+	if( node == NULL || !node->m_circuitOpen )
+	{
+		return false;
+	}
+
+	node->m_circuitOpen = false;
+	if( m_openCircuits != 0 )
+	{
+		m_openCircuits--;
+	}
+
+	// Take the messages out in one go, and then queue them as though they
+	// were new, so that they pass through SendMsg again.  Each goes back on
+	// the queue it came from, so that polls still wait for the driver to be
+	// idle and queries stay in step with their query stages.
+	list<MsgQueueItem> items;
+	m_sendMutex->Lock();
+	list<MsgQueueItem>& parked = m_parkedQueue.GetNodeItems( _nodeId );
+	while( !parked.empty() )
+	{
+		items.push_back( parked.front() );
+		m_parkedQueue.Erase( _nodeId, parked.begin() );
+	}
+	m_sendMutex->Unlock();
+
+	Log::Write( LogLevel_Info, _nodeId, "Node answering again - sending %d message(s) held back for it", (int)items.size() );
+	bool queryStageQueued = false;
+	for( list<MsgQueueItem>::iterator it = items.begin(); it != items.end(); ++it )
+	{
+		MsgQueueItem const& item = *it;
+		if( MsgQueueCmd_SendMsg == item.m_command )
+		{
+			SendMsg( item.m_msg, item.m_queue );
+		}
+		else
+		{
+			if( MsgQueueCmd_QueryStageComplete == item.m_command )
+			{
+				queryStageQueued = true;
+			}
+			m_sendMutex->Lock();
+			m_msgQueue[item.m_queue].push_back( item );
+			m_queueEvent[item.m_queue]->Set();
+			m_sendMutex->Unlock();
+		}
+	}
+	return queryStageQueued;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::ParkMsg>
+// Hold back a message for a node whose circuit is open.  A message which
+// does the same job as one already held back replaces it, so that a node
+// which is gone for a long time does not build up a backlog of polls.
+// Must be called with m_sendMutex held.
+//-----------------------------------------------------------------------------
+void Driver::ParkMsg
+(
+	MsgQueueItem const& _item,
+	MsgQueue const _queue
+)
+{
+	if( MsgQueueCmd_SendMsg == _item.m_command )
+	{
+		// Probes are not worth keeping, the node will be sent another
+		if( _item.m_msg->IsNoOperation() || _item.m_msg->IsWakeUpNoMoreInformationCommand() )
+		{
+			delete _item.m_msg;
+			return;
+		}
+
+		// The nonce will have expired long before the node answers again
+		if( _item.m_msg->CarriesNonce() )
+		{
+			Log::Write( LogLevel_Warning, _item.m_msg->GetTargetNodeId(), "WARNING: Dropping secure message for a node which is not answering: %s", _item.m_msg->GetAsString().c_str() );
+			delete _item.m_msg;
+			m_dropped++;
+			return;
+		}
+		OZW_LOG( LogLevel_Detail, _item.m_msg->GetTargetNodeId(), "Holding back message until the node answers: %s", _item.m_msg->GetAsString().c_str() );
+	}
+
+	MsgQueueItem item = _item;
+	item.m_queue = _queue;
+
+	// A newer copy takes the place of the old one, so that it stays in
+	// order with the messages around it (a Get ahead of its query stage's
+	// marker, for instance).
+	list<MsgQueueItem>& items = m_parkedQueue.GetNodeItems( SendQueue::GetItemNodeId( _item ) );
+	for( list<MsgQueueItem>::iterator it = items.begin(); it != items.end(); ++it )
+	{
+		bool replace = ( *it == _item );
+		if( !replace && MsgQueueCmd_SendMsg == _item.m_command && MsgQueueCmd_SendMsg == it->m_command )
+		{
+			replace = _item.m_msg->IsSameSet( *it->m_msg );
+		}
+
+		if( replace )
+		{
+			if( MsgQueueCmd_SendMsg == it->m_command )
+			{
+				delete it->m_msg;
+			}
+			*it = item;
+			m_parked++;
+			return;
+		}
+	}
+
+	m_parkedQueue.push_back( item );
+	m_parked++;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::ParkCurrentMsg>
+// Hold back the message being sent, as its node has stopped answering
+//-----------------------------------------------------------------------------
+void Driver::ParkCurrentMsg
+(
+)
+{
+	MsgQueueItem item;
+	item.m_command = MsgQueueCmd_SendMsg;
+	item.m_msg = m_currentMsg;
+	item.m_msg->SetSendAttempts( 0 );
+
+	m_sendMutex->Lock();
+	ParkMsg( item, m_currentMsgQueueSource );
+	m_sendMutex->Unlock();
+
+	m_currentMsg = NULL;
+	m_expectedCallbackId = 0;
+	m_expectedCommandClassId = 0;
+	m_expectedNodeId = 0;
+	m_expectedReply = 0;
+	m_waitingForAck = false;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::SendProbes>
+// Send a No Operation to each node whose circuit is open and is due a
+// probe.  The wait before the next one doubles each time, so that a node
+// which has gone for good does not keep taking up the network.
+//-----------------------------------------------------------------------------
+void Driver::SendProbes
+(
+)
+{
+	uint32 open = 0;
+	int32 next = m_deadNodeProbeInterval << 6;
+
+	LockNodes();
+	for( int i=0; i<256; ++i )
+	{
+		Node* node = m_nodes[i];
+		if( node == NULL || !node->m_circuitOpen )
+		{
+			continue;
+		}
+
+		++open;
+		int32 remaining = node->m_nextProbe.TimeRemaining();
+		if( remaining <= 0 )
+		{
+			if( NoOperation* noop = static_cast<NoOperation*>( node->GetCommandClass( NoOperation::StaticGetCommandClassId() ) ) )
+			{
+				Log::Write( LogLevel_Info, node->GetNodeId(), "Probing node which is presumed dead" );
+				noop->Set( true );
+			}
+			if( node->m_probeBackoff < 6 )
+			{
+				node->m_probeBackoff++;
+			}
+			remaining = m_deadNodeProbeInterval << node->m_probeBackoff;
+			node->m_nextProbe.SetTime( remaining );
+		}
+		if( remaining < next )
+		{
+			next = remaining;
+		}
+	}
+	ReleaseNodes();
+
+	// Nodes which were removed while presumed dead are forgotten here
+	m_openCircuits = open;
+	m_probeTimeStamp.SetTime( next );
+}
+
 //-----------------------------------------------------------------------------
 // <Driver::HandleErrorResponse>
 // For messages that return a ZW_SEND_DATA response, process the results here
@@ -1437,10 +2219,7 @@ bool Driver::HandleErrorResponse
 	}
 	if( Node* node = GetNodeUnsafe( _nodeId ) )
 	{
-		if( ++node->m_errors >= 3 )
-		{
-			node->SetNodeAlive( false );
-		}
+		RecordNodeFailure( node );
 	}
 	return false;
 }
@@ -1503,6 +2282,7 @@ void Driver::CheckCompletedNodeQueries
 			}
 			m_awakeNodesQueried = true;
 			m_allNodesQueried = true;
+			m_pollEvent->Set();
 		}
 		else if( sleepingOnly )
 		{
@@ -1514,6 +2294,7 @@ void Driver::CheckCompletedNodeQueries
 				notification->SetHomeAndNodeIds( m_homeId, 0xff );
 				QueueNotification( notification );
 				m_awakeNodesQueried = true;
+				m_pollEvent->Set();
 			}
 		}
 	}
@@ -1568,162 +2349,212 @@ bool Driver::ReadMsg
 (
 )
 {
-	uint8 buffer[1024] = {0};
+	uint64 now = TimeStamp::GetMonotonic();
 
-	if( !m_controller->Read( buffer, 1 ) )
+	// A partial frame whose remainder has not turned up is given up on, so
+	// that it does not swallow whatever arrives next.
+	if( ( m_rxLength > 0 ) && ( now - m_rxPartialTime > 500000 ) )
+	{
+		Log::Write( LogLevel_Warning, "WARNING: 500ms passed without reading the rest of the frame...aborting frame read" );
+		m_readAborts++;
+		m_rxLength = 0;
+	}
+
+	// Take everything the read thread has handed over so far, in one go
+	uint32 available = m_controller->GetDataSize();
+	if( available > sizeof(m_rxBuffer) - m_rxLength )
+	{
+		available = sizeof(m_rxBuffer) - m_rxLength;
+	}
+	if( available == 0 || !m_controller->Read( &m_rxBuffer[m_rxLength], available ) )
 	{
 		// Nothing to read
 		return false;
 	}
+	bool partial = ( m_rxLength > 0 );
+	m_rxLength += available;
+
+	// Data is handed over by the read thread as it arrives, so the last
+	// arrival is our best estimate of when the frames were received.
+	m_frameReadTime = m_controller->GetPutTime();
 
-	switch( buffer[0] )
+	// Handle every complete frame and control byte in the buffer
+	uint32 pos = 0;
+	while( pos < m_rxLength )
 	{
-		case SOF:
-		{
-			m_SOFCnt++;
-			if( m_waitingForAck )
-			{
-				// This can happen on any normal network when a transmission overlaps an unexpected
-				// reception and the data in the buffer doesn't contain the ACK. The controller will
-				// notice and send us a CAN to retransmit.
-				Log::Write( LogLevel_Detail, "Unsolicited message received while waiting for ACK." );
-				m_ACKWaiting++;
-			}
+		uint8* frame = &m_rxBuffer[pos];
+		uint32 remaining = m_rxLength - pos;
 
-			// Read the length byte.  Keep trying until we get it.
-			m_controller->SetSignalThreshold( 1 );
-			int32 response = Wait::Single( m_controller, 50 );
-			if( response < 0 )
+		if( SOF == frame[0] )
+		{
+			if( ( remaining < 2 ) || ( remaining < (uint32)frame[1] + 2 ) )
 			{
-				Log::Write( LogLevel_Warning, "WARNING: 50ms passed without finding the length byte...aborting frame read");
-				m_readAborts++;
+				// Wait for the rest of the frame
 				break;
 			}
-
-			m_controller->Read( &buffer[1], 1 );
-			m_controller->SetSignalThreshold( buffer[1] );
-			if( Wait::Single( m_controller, 500 ) < 0 )
+			if( !ReadFrame( frame ) )
 			{
-				Log::Write( LogLevel_Warning, "WARNING: 500ms passed without reading the rest of the frame...aborting frame read" );
-				m_readAborts++;
-				m_controller->SetSignalThreshold( 1 );
-				break;
+				// Bad checksum, nothing more in the buffer can be trusted
+				m_rxLength = 0;
+				return true;
 			}
+			pos += frame[1] + 2;
+			continue;
+		}
 
-			m_controller->Read( &buffer[2], buffer[1] );
-			m_controller->SetSignalThreshold( 1 );
-
-			uint32 length = buffer[1] + 2;
-
-			// Log the data
-			string str = "";
-			for( uint32 i=0; i<length; ++i )
+		pos++;
+		switch( frame[0] )
+		{
+			case CAN:
 			{
-				if( i )
+				// This is the other side of an unsolicited ACK. As mentioned there if we receive a message
+				// just after we transmitted one, the controller will notice and tell us to retransmit here.
+				// Don't increment the transmission counter as it is possible the message will never get out
+				// on very busy networks with lots of unsolicited messages being received. Increase the amount
+				// of retries but only up to a limit so we don't stay here forever.
+				Log::Write( LogLevel_Detail, GetNodeNumber( m_currentMsg ), "CAN received...triggering resend" );
+				m_CANCnt++;
+				if( m_currentMsg != NULL )
 				{
-					str += ", ";
+					m_currentMsg->SetMaxSendAttempts( m_currentMsg->GetMaxSendAttempts() + 1 );
 				}
-
-				char byteStr[8];
-				snprintf( byteStr, sizeof(byteStr), "0x%.2x", buffer[i] );
-				str += byteStr;
-			}
-			uint8 nodeId = NodeFromMessage( buffer );
-			if( nodeId == 0 )
-			{
-				nodeId = GetNodeNumber( m_currentMsg );
+				else
+				{
+					Log::Write( LogLevel_Warning, "m_currentMsg was NULL when trying to set MaxSendAttempts" );
+					Log::QueueDump();
+				}
+				WriteMsg( "CAN" );
+				break;
 			}
-			Log::Write( LogLevel_Detail, nodeId, "  Received: %s", str.c_str() );
 
-			// Verify checksum
-			uint8 checksum = 0xff;
-			for( uint32 i=1; i<(length-1); ++i )
+			case NAK:
 			{
-				checksum ^= buffer[i];
+				Log::Write( LogLevel_Warning, GetNodeNumber( m_currentMsg ), "WARNING: NAK received...triggering resend" );
+				m_NAKCnt++;
+				WriteMsg( "NAK" );
+				break;
 			}
 
-			if( buffer[length-1] == checksum )
+			case ACK:
 			{
-				// Checksum correct - send ACK
-				uint8 ack = ACK;
-				m_controller->Write( &ack, 1 );
-				m_readCnt++;
-
-				// Process the received message
-				ProcessMsg( &buffer[2] );
+				m_ACKCnt++;
+				m_waitingForAck = false;
+				if( m_currentMsg == NULL )
+				{
+					Log::Write( LogLevel_StreamDetail, 255, "  ACK received" );
+				}
+				else
+				{
+					Log::Write( LogLevel_StreamDetail, GetNodeNumber( m_currentMsg ), "  ACK received CallbackId 0x%.2x Reply 0x%.2x", m_expectedCallbackId, m_expectedReply );
+					if( ( 0 == m_expectedCallbackId ) && ( 0 == m_expectedReply ) )
+					{
+						// Remove the message from the queue, now that it has been acknowledged.
+						RemoveCurrentMsg();
+					}
+				}
+				break;
 			}
-			else
+
+			default:
 			{
-				Log::Write( LogLevel_Warning, nodeId, "WARNING: Checksum incorrect - sending NAK" );
-				m_badChecksum++;
+				Log::Write( LogLevel_Warning, "WARNING: Out of frame flow! (0x%.2x).  Sending NAK.", frame[0] );
+				m_OOFCnt++;
 				uint8 nak = NAK;
 				m_controller->Write( &nak, 1 );
 				m_controller->Purge();
+				m_rxLength = 0;
+				return true;
 			}
-			break;
 		}
+	}
 
-		case CAN:
+	// Keep any partial frame for next time
+	if( pos < m_rxLength )
+	{
+		if( pos > 0 || !partial )
 		{
-			// This is the other side of an unsolicited ACK. As mentioned there if we receive a message
-			// just after we transmitted one, the controller will notice and tell us to retransmit here.
-			// Don't increment the transmission counter as it is possible the message will never get out
-			// on very busy networks with lots of unsolicited messages being received. Increase the amount
-			// of retries but only up to a limit so we don't stay here forever.
-			Log::Write( LogLevel_Detail, GetNodeNumber( m_currentMsg ), "CAN received...triggering resend" );
-			m_CANCnt++;
-			if( m_currentMsg != NULL )
-			{
-				m_currentMsg->SetMaxSendAttempts( m_currentMsg->GetMaxSendAttempts() + 1 );
-			}
-			else
-			{
-				Log::Write( LogLevel_Warning, "m_currentMsg was NULL when trying to set MaxSendAttempts" );
-				Log::QueueDump();
-			}
-			WriteMsg( "CAN" );
-			break;
+			m_rxPartialTime = now;
 		}
+		memmove( m_rxBuffer, &m_rxBuffer[pos], m_rxLength - pos );
+	}
+	m_rxLength -= pos;
 
-		case NAK:
-		{
-			Log::Write( LogLevel_Warning, GetNodeNumber( m_currentMsg ), "WARNING: NAK received...triggering resend" );
-			m_NAKCnt++;
-			WriteMsg( "NAK" );
-			break;
-		}
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::ReadFrame>
+// Verify and process a complete frame, which starts with SOF
+//-----------------------------------------------------------------------------
+bool Driver::ReadFrame
+(
+	uint8* _frame
+)
+{
+	m_SOFCnt++;
+
+	if( m_waitingForAck )
+	{
+		// This can happen on any normal network when a transmission overlaps an unexpected
+		// reception and the data in the buffer doesn't contain the ACK. The controller will
+		// notice and send us a CAN to retransmit.
+		Log::Write( LogLevel_Detail, "Unsolicited message received while waiting for ACK." );
+		m_ACKWaiting++;
+	}
 
-		case ACK:
+	uint32 length = _frame[1] + 2;
+
+	uint8 nodeId = NodeFromMessage( _frame );
+	if( nodeId == 0 )
+	{
+		nodeId = GetNodeNumber( m_currentMsg );
+	}
+
+	// Log the data
+	if( Log::IsEnabled( LogLevel_Detail, nodeId ) )
+	{
+		string str = "";
+		for( uint32 i=0; i<length; ++i )
 		{
-			m_ACKCnt++;
-			m_waitingForAck = false;
-			if( m_currentMsg == NULL )
+			if( i )
 			{
-				Log::Write( LogLevel_StreamDetail, 255, "  ACK received" );
+				str += ", ";
 			}
-			else
-			{
-				Log::Write( LogLevel_StreamDetail, GetNodeNumber( m_currentMsg ), "  ACK received CallbackId 0x%.2x Reply 0x%.2x", m_expectedCallbackId, m_expectedReply );
-				if( ( 0 == m_expectedCallbackId ) && ( 0 == m_expectedReply ) )
-				{
-					// Remove the message from the queue, now that it has been acknowledged.
-					RemoveCurrentMsg();
-				}
-			}
-			break;
-		}
 
-		default:
-		{
-			Log::Write( LogLevel_Warning, "WARNING: Out of frame flow! (0x%.2x).  Sending NAK.", buffer[0] );
-			m_OOFCnt++;
-			uint8 nak = NAK;
-			m_controller->Write( &nak, 1 );
-			m_controller->Purge();
-			break;
+			char byteStr[8];
+			snprintf( byteStr, sizeof(byteStr), "0x%.2x", _frame[i] );
+			str += byteStr;
 		}
+		Log::Write( LogLevel_Detail, nodeId, "  Received: %s", str.c_str() );
 	}
 
+	// Verify checksum
+	uint8 checksum = 0xff;
+	for( uint32 i=1; i<(length-1); ++i )
+	{
+		checksum ^= _frame[i];
+	}
+
+	if( _frame[length-1] != checksum )
+	{
+		Log::Write( LogLevel_Warning, nodeId, "WARNING: Checksum incorrect - sending NAK" );
+		m_badChecksum++;
+		uint8 nak = NAK;
+		m_controller->Write( &nak, 1 );
+		m_controller->Purge();
+		return false;
+	}
+
+	// Checksum correct - send ACK
+	uint8 ack = ACK;
+	m_controller->Write( &ack, 1 );
+	m_readCnt++;
+
+	// Process the received message
+	m_frameTime = TimeStamp::GetMonotonic();
+	m_inFrame = true;
+	ProcessMsg( &_frame[2] );
+	m_inFrame = false;
 	return true;
 }
 
@@ -2446,6 +3277,12 @@ void Driver::HandleSerialAPIGetInitDataResponse
 		// Read the config file first, to get the last known state
 		//ReadConfig();
 	}
+	else if( m_reconnecting )
+	{
+		// The controller has been reopened.  Our nodes are still valid,
+		// so only the differences below are reported.
+		Log::Write( LogLevel_Info, "Controller reconnected, comparing node list" );
+	}
 	else
 	{
 		// Notify the user that all node and value information has been deleted
@@ -2520,6 +3357,7 @@ void Driver::HandleSerialAPIGetInitDataResponse
 	}
 
 	m_init = true;
+	m_reconnecting = false;
 }
 
 //-----------------------------------------------------------------------------
@@ -2813,6 +3651,9 @@ void Driver::HandleSendDataRequest
 			{
 				node->m_lastRequestRTT = -node->m_sentTS.TimeRemaining();
 
+				// Each attempt has its own callback ID, so this is always for the latest one
+				node->UpdateRTT( node->m_lastRequestRTT, false );
+
 				if( node->m_averageRequestRTT )
 				{
 					// if the average has been established, update by averaging the average and the last RTT
@@ -2847,10 +3688,18 @@ void Driver::HandleSendDataRequest
 				{
 					node->QueryStageRetry( node->GetCurrentQueryStage(), 3 );
 				}
+				else if( node != NULL && node->m_circuitOpen && !m_currentMsg->IsNoOperation() && m_currentControllerCommand == NULL )
+				{
+					// The node has just been presumed dead, so keep the message with the others held back for it
+					ParkCurrentMsg();
+				}
 			}
 		}
 		else if( node != NULL )
 		{
+			// The node heard us, so it has not failed
+			node->m_errors = 0;
+
 		  	// If WakeUpNoMoreInformation request succeeds, update our status
 		  	if( m_currentMsg->IsWakeUpNoMoreInformationCommand() )
 			{
@@ -3314,6 +4163,13 @@ void Driver::HandleApplicationCommandHandlerRequest
 			// At least ignore any received messages prior to the send data request.
 			node->m_lastResponseRTT = -node->m_sentTS.TimeRemaining();
 
+			// A report can't be told apart from one answering an earlier attempt,
+			// so only the first attempt is measured (Karn's algorithm)
+			if( m_currentMsg != NULL && m_currentMsg->GetSendAttempts() <= 1 )
+			{
+				node->UpdateRTT( node->m_lastResponseRTT, true );
+			}
+
 			if( node->m_averageResponseRTT )
 			{
 				// if the average has been established, update by averaging the average and the last RTT
@@ -3774,26 +4630,20 @@ bool Driver::EnablePoll
 			// update the value's pollIntensity
 			value->SetPollIntensity( _intensity );
 
-			// Add the valueid to the polling list
-			// See if the node is already in the poll list.
-			for( list<PollEntry>::iterator it = m_pollList.begin(); it != m_pollList.end(); ++it )
+			// See if the value is already in the poll schedule.
+			if( m_pollIndex.find( _valueId ) != m_pollIndex.end() )
 			{
-				if( (*it).m_id == _valueId )
-				{
-					// It is already in the poll list, so we have nothing to do.
-					Log::Write( LogLevel_Detail, "EnablePoll not required to do anything (value is already in the poll list)" );
-					value->Release();
-					m_pollMutex->Unlock();
-					ReleaseNodes();
-					return true;
-				}
+				// It is, but it may now be due sooner
+				SchedulePoll( _valueId, GetValuePollInterval( value ) );
+				Log::Write( LogLevel_Detail, "EnablePoll not required to do anything (value is already in the poll list)" );
+				value->Release();
+				m_pollMutex->Unlock();
+				ReleaseNodes();
+				return true;
 			}
 
-			// Not in the list, so we add it
-			PollEntry pe;
-			pe.m_id = _valueId;
-			pe.m_pollCounter = value->GetPollIntensity();
-			m_pollList.push_back( pe );
+			// Not in the schedule, so we add it
+			SchedulePoll( _valueId, GetValuePollInterval( value ) );
 			value->Release();
 			m_pollMutex->Unlock();
 			ReleaseNodes();
@@ -3803,7 +4653,7 @@ bool Driver::EnablePoll
 			notification->SetHomeAndNodeIds( m_homeId, _valueId.GetNodeId() );
 			QueueNotification( notification );
 			Log::Write( LogLevel_Info, nodeId, "EnablePoll for HomeID 0x%.8x, value(cc=0x%02x,in=0x%02x,id=0x%02x)--poll list has %d items",
-				    _valueId.GetHomeId(), _valueId.GetCommandClassId(), _valueId.GetIndex(), _valueId.GetInstance(), m_pollList.size() );
+				    _valueId.GetHomeId(), _valueId.GetCommandClassId(), _valueId.GetIndex(), _valueId.GetInstance(), m_pollIndex.size() );
 			return true;
 		}
 
@@ -3839,32 +4689,32 @@ bool Driver::DisablePoll
 	Node* node = GetNode( nodeId );
 	if( node != NULL)
 	{
-		// See if the value is already in the poll list.
-		for( list<PollEntry>::iterator it = m_pollList.begin(); it != m_pollList.end(); ++it )
+		// See if the value is in the poll schedule.
+		map<ValueID, PollSchedule::iterator>::iterator it = m_pollIndex.find( _valueId );
+		if( it != m_pollIndex.end() )
 		{
-			if( (*it).m_id == _valueId )
-			{
-				// Found it
-				// remove it from the poll list
-				m_pollList.erase( it );
+			// Found it
+			// remove it from the poll schedule
+			m_pollSchedule.erase( it->second );
+			m_pollIndex.erase( it );
+			m_pollEvent->Set();
 
-				// get the value object and reset pollIntensity to zero (indicating no polling)
-				Value* value = GetValue( _valueId );
-                                if (!value)
-                                        continue;
+			// get the value object and reset pollIntensity to zero (indicating no polling)
+			if( Value* value = GetValue( _valueId ) )
+			{
 				value->SetPollIntensity( 0 );
 				value->Release();
-				m_pollMutex->Unlock();
-				ReleaseNodes();
-
-				// send notification to indicate polling is disabled
-				Notification* notification = new Notification( Notification::Type_PollingDisabled );
-				notification->SetHomeAndNodeIds( m_homeId, _valueId.GetNodeId() );
-				QueueNotification( notification );
-				Log::Write( LogLevel_Info, nodeId, "DisablePoll for HomeID 0x%.8x, value(cc=0x%02x,in=0x%02x,id=0x%02x)--poll list has %d items",
-					    _valueId.GetHomeId(), _valueId.GetCommandClassId(), _valueId.GetIndex(), _valueId.GetInstance(), m_pollList.size() );
-				return true;
 			}
+			m_pollMutex->Unlock();
+			ReleaseNodes();
+
+			// send notification to indicate polling is disabled
+			Notification* notification = new Notification( Notification::Type_PollingDisabled );
+			notification->SetHomeAndNodeIds( m_homeId, _valueId.GetNodeId() );
+			QueueNotification( notification );
+			Log::Write( LogLevel_Info, nodeId, "DisablePoll for HomeID 0x%.8x, value(cc=0x%02x,in=0x%02x,id=0x%02x)--poll list has %d items",
+				    _valueId.GetHomeId(), _valueId.GetCommandClassId(), _valueId.GetIndex(), _valueId.GetInstance(), m_pollIndex.size() );
+			return true;
 		}
 
 		// Not in the list
@@ -3909,7 +4759,7 @@ bool Driver::isPolled
 
 	/*
 	 * This code is retained for the moment as a belt-and-suspenders test to confirm that
-	 * the pollIntensity member of each value and the pollList contents do not get out
+	 * the pollIntensity member of each value and the poll schedule do not get out
 	 * of sync.
 	 */
 	// confirm that this node exists
@@ -3917,23 +4767,19 @@ bool Driver::isPolled
 	Node* node = GetNode( nodeId );
 	if( node != NULL)
 	{
-
-		// See if the value is already in the poll list.
-		for( list<PollEntry>::iterator it = m_pollList.begin(); it != m_pollList.end(); ++it )
+		// See if the value is in the poll schedule.
+		if( m_pollIndex.find( _valueId ) != m_pollIndex.end() )
 		{
-			if( (*it).m_id == _valueId )
+			// Found it
+			if( bPolled )
 			{
-				// Found it
-				if( bPolled )
-				{
-					m_pollMutex->Unlock();
-					ReleaseNodes();
-					return true;
-				}
-				else
-				{
-					Log::Write( LogLevel_Error, nodeId, "IsPolled setting for valueId 0x%016x is not consistent with the poll list", _valueId.GetId() );
-				}
+				m_pollMutex->Unlock();
+				ReleaseNodes();
+				return true;
+			}
+			else
+			{
+				Log::Write( LogLevel_Error, nodeId, "IsPolled setting for valueId 0x%016x is not consistent with the poll list", _valueId.GetId() );
 			}
 		}
 
@@ -3973,13 +4819,199 @@ void Driver::SetPollIntensity
 
 	Value* value = GetValue( _valueId );
 	if (!value)
+	{
+		m_pollMutex->Unlock();
 	        return;
+	}
 	value->SetPollIntensity( _intensity );
 
+	// A more frequent poll should not have to wait for the old one to come round
+	if( m_pollIndex.find( _valueId ) != m_pollIndex.end() )
+	{
+		SchedulePoll( _valueId, GetValuePollInterval( value ) );
+	}
+
+	value->Release();
+	m_pollMutex->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::SetPollInterval>
+// Set how often this value is polled, in milliseconds
+//-----------------------------------------------------------------------------
+void Driver::SetPollInterval
+(
+	ValueID const &_valueId,
+	uint32 const _milliseconds
+)
+{
+	// make sure the polling thread doesn't lock the value while we're in this function
+	m_pollMutex->Lock();
+
+	Value* value = GetValue( _valueId );
+	if( !value )
+	{
+		m_pollMutex->Unlock();
+		return;
+	}
+	value->SetPollInterval( _milliseconds );
+
+	if( m_pollIndex.find( _valueId ) != m_pollIndex.end() )
+	{
+		SchedulePoll( _valueId, GetValuePollInterval( value ) );
+	}
+
 	value->Release();
 	m_pollMutex->Unlock();
 }
 
+//-----------------------------------------------------------------------------
+// <Driver::GetValuePollInterval>
+// How often a value is polled, in milliseconds.  Unless the value has an
+// interval of its own, it is polled once every poll interval, or once for
+// every value when the poll interval is the wait between polls, slowed
+// down by its poll intensity.  It is never longer than the poll thread
+// can wait in one go.
+//-----------------------------------------------------------------------------
+uint32 Driver::GetValuePollInterval
+(
+	Value const* _value
+)
+{
+	if( _value->GetPollInterval() != 0 )
+	{
+		return _value->GetPollInterval() < c_maxPollInterval ? _value->GetPollInterval() : c_maxPollInterval;
+	}
+
+	uint64 interval = m_pollInterval > 0 ? (uint64)m_pollInterval : 0;
+	if( m_bIntervalBetweenPolls )
+	{
+		// Count the value itself if it is only now being added to the schedule
+		uint64 count = m_pollIndex.size();
+		if( m_pollIndex.find( _value->GetID() ) == m_pollIndex.end() )
+		{
+			count++;
+		}
+		interval *= count;
+	}
+	else if( interval < 100 )
+	{
+		// A legacy setting in seconds
+		interval *= 1000;
+	}
+
+	uint8 intensity = _value->GetPollIntensity();
+	interval *= ( intensity ? intensity : 1 );
+	return interval < c_maxPollInterval ? (uint32)interval : c_maxPollInterval;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::SchedulePoll>
+// Add a value to the poll schedule, at a random point within its first
+// interval so that values enabled together do not all fall due together.
+// A value already in the schedule is only ever brought forward.  Must be
+// called with m_pollMutex held.
+//-----------------------------------------------------------------------------
+void Driver::SchedulePoll
+(
+	ValueID const& _valueId,
+	uint32 const _interval
+)
+{
+	uint64 due = TimeStamp::GetMonotonic();
+	if( _interval != 0 )
+	{
+		due += ( (uint64)rand() % _interval ) * 1000;
+	}
+
+	map<ValueID, PollSchedule::iterator>::iterator it = m_pollIndex.find( _valueId );
+	if( it != m_pollIndex.end() )
+	{
+		if( it->second->first <= TimeStamp::GetMonotonic() + (uint64)_interval * 1000 )
+		{
+			// Already due within the new interval
+			return;
+		}
+		m_pollSchedule.erase( it->second );
+		it->second = m_pollSchedule.insert( PollSchedule::value_type( due, _valueId ) );
+	}
+	else
+	{
+		m_pollIndex[_valueId] = m_pollSchedule.insert( PollSchedule::value_type( due, _valueId ) );
+	}
+
+	// Wake the poll thread, in case this is the first poll due
+	m_pollEvent->Set();
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::IsPollIdle>
+// Polls are only sent when no other messages are waiting to be sent
+//-----------------------------------------------------------------------------
+bool Driver::IsPollIdle
+(
+)const
+{
+	return( m_currentMsg == NULL
+		&& m_msgQueue[MsgQueue_Poll].empty()
+		&& m_msgQueue[MsgQueue_Send].empty()
+		&& m_msgQueue[MsgQueue_Command].empty()
+		&& m_msgQueue[MsgQueue_Query].empty() );
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::SkipFreshPoll>
+// A value which was refreshed recently, usually by a report the node sent
+// by itself, does not need asking for again yet.  If the value due first is
+// one of those, put it back in for its next poll without sending anything.
+//-----------------------------------------------------------------------------
+bool Driver::SkipFreshPoll
+(
+)
+{
+	if( m_freshPollPercent <= 0 )
+	{
+		return false;
+	}
+
+	bool skip = false;
+	m_pollMutex->Lock();
+	if( !m_pollSchedule.empty() )
+	{
+		PollSchedule::iterator pit = m_pollSchedule.begin();
+		ValueID valueId = pit->second;
+
+		// The node objects stay locked while the value is looked at.  A value
+		// which has gone is left for the poll thread to drop from the schedule.
+		if( GetNode( valueId.GetNodeId() ) )
+		{
+			if( Value* value = GetValue( valueId ) )
+			{
+				uint64 now = TimeStamp::GetMonotonic();
+				uint64 interval = (uint64)GetValuePollInterval( value ) * 1000;
+				uint64 refreshed = value->m_refreshTimeStamp;
+				if( refreshed != 0 && now - refreshed < interval * m_freshPollPercent / 100 )
+				{
+					OZW_LOG_CC( LogLevel_Detail, valueId.GetNodeId(), valueId.GetCommandClassId(), "Not polling index = %d instance = %d, refreshed %d ms ago", valueId.GetIndex(), valueId.GetInstance(), (int)( ( now - refreshed ) / 1000 ) );
+					uint64 next = pit->first + interval;
+					if( next < now )
+					{
+						next = now + interval;
+					}
+					m_pollSchedule.erase( pit );
+					m_pollIndex[valueId] = m_pollSchedule.insert( PollSchedule::value_type( next, valueId ) );
+					m_skippedPolls++;
+					skip = true;
+				}
+				value->Release();
+			}
+			ReleaseNodes();
+		}
+	}
+	m_pollMutex->Unlock();
+	return skip;
+}
+
 //-----------------------------------------------------------------------------
 // <Driver::PollThreadEntryPoint>
 // Entry point of the thread for poll Z-Wave devices
@@ -3999,140 +5031,155 @@ void Driver::PollThreadEntryPoint
 
 //-----------------------------------------------------------------------------
 // <Driver::PollThreadProc>
-// Thread for poll Z-Wave devices
+// Thread for poll Z-Wave devices.  It sleeps until the next value in the
+// schedule is due, and then until the driver has nothing else to send.
+// Neither wait wakes up unless something has changed.
 //-----------------------------------------------------------------------------
 void Driver::PollThreadProc
 (
 	Event* _exitEvent
 )
 {
+	Wait* scheduleObjects[2] = { _exitEvent, m_pollEvent };
+	Wait* idleObjects[2] = { _exitEvent, m_pollIdleEvent };
+	uint64 lastPoll = 0;
+
 	while( 1 )
 	{
-		int32 pollInterval = m_pollInterval;
-
-		if( m_awakeNodesQueried && !m_pollList.empty() )
+		// Work out how long until the next poll is due
+		int32 timeout = Wait::Timeout_Infinite;
+		bool notDue = false;
+		m_pollMutex->Lock();
+		m_pollEvent->Reset();
+		if( m_awakeNodesQueried && !m_pollSchedule.empty() )
 		{
-			// We only bother getting the lock if the pollList is not empty
-			m_pollMutex->Lock();
-
-			// Get the next value to be polled
-			PollEntry pe = m_pollList.front();
-			m_pollList.pop_front();
-			ValueID  valueId = pe.m_id;
+			uint64 due = m_pollSchedule.begin()->first;
+			if( m_bIntervalBetweenPolls && m_pollInterval > 0 && due < lastPoll + (uint64)m_pollInterval * 1000 )
+			{
+				due = lastPoll + (uint64)m_pollInterval * 1000;
+			}
+			uint64 now = TimeStamp::GetMonotonic();
+			uint64 wait = due > now ? ( due - now + 999 ) / 1000 : 0;
+			if( wait > c_maxPollInterval )
+			{
+				// Too long for one wait, so it takes more than one
+				wait = c_maxPollInterval;
+				notDue = true;
+			}
+			timeout = (int32)wait;
+		}
+		m_pollMutex->Unlock();
 
-			// only execute this poll if pe.m_pollCounter == 1; otherwise decrement the counter and process the next polled value
-			if( pe.m_pollCounter != 1)
+		if( timeout != 0 )
+		{
+			// Sleep until then, or until the schedule changes
+			int32 res = Wait::Multiple( scheduleObjects, 2, timeout );
+			if( res == 0 )
 			{
-				pe.m_pollCounter--;
-				m_pollList.push_back( pe );
-				m_pollMutex->Unlock();
+				// Exit has been called
+				return;
+			}
+			if( res == 1 || notDue )
+			{
+				// Look at the schedule again
 				continue;
 			}
+		}
 
-			// reset the poll counter to the full pollIntensity value and push it at the end of the list
-			// release the value object referenced; call GetNode to ensure the node objects are locked during this period
-			(void)GetNode( valueId.GetNodeId() );
-			Value* value = GetValue( valueId );
-			if (!value)
-			        continue;
-			pe.m_pollCounter = value->GetPollIntensity();
-			m_pollList.push_back( pe );
-			value->Release();
-			ReleaseNodes();
+		if( SkipFreshPoll() )
+		{
+			// Nothing to send, so there is no need to wait for the driver
+			continue;
+		}
 
-			// If the polling interval is for the whole poll list, calculate the time before the next poll,
-			// so that all polls can take place within the user-specified interval.
-			if( !m_bIntervalBetweenPolls )
+		// Polling messages are only sent when there are no other messages waiting to be sent.
+		// The driver thread signals when it runs out of work, so wait for that rather than
+		// checking over and over.
+		m_pollIdleEvent->Reset();
+		if( !IsPollIdle() )
+		{
+			if( Wait::Multiple( idleObjects, 2 ) == 0 )
 			{
-				if( pollInterval < 100 )
-				{
-					Log::Write( LogLevel_Info, "The pollInterval setting is only %d, which appears to be a legacy setting.  Multiplying by 1000 to convert to ms.", pollInterval );
-					pollInterval *= 1000;
-				}
-				pollInterval /= (int32) m_pollList.size();
+				// Exit has been called
+				return;
 			}
 
-			// Request the state of the value from the node to which it belongs
-			if( Node* node = GetNode( valueId.GetNodeId() ) )
-			{
-				bool requestState = true;
-				if( !node->IsListeningDevice() )
-				{
-					// The device is not awake all the time.  If it is not awake, we mark it
-					// as requiring a poll.  The poll will be done next time the node wakes up.
-					if( WakeUp* wakeUp = static_cast<WakeUp*>( node->GetCommandClass( WakeUp::StaticGetCommandClassId() ) ) )
-					{
-						if( !wakeUp->IsAwake() )
-						{
-							wakeUp->SetPollRequired();
-							requestState = false;
-						}
-					}
-				}
+			// The schedule may have changed while we waited
+			continue;
+		}
 
-				if( requestState )
-				{
-					// Request an update of the value
-					CommandClass* cc = node->GetCommandClass( valueId.GetCommandClassId() );
-					if (cc) {
-        					uint8 index = valueId.GetIndex();
-	        				uint8 instance = valueId.GetInstance();
-		        			Log::Write( LogLevel_Detail, node->m_nodeId, "Polling: %s index = %d instance = %d (poll queue has %d messages)", cc->GetCommandClassName().c_str(), index, instance, m_msgQueue[MsgQueue_Poll].size() );
-			        		cc->RequestValue( 0, index, instance, MsgQueue_Poll );
-                                        }
-				}
+		m_pollMutex->Lock();
+		if( m_pollSchedule.empty() )
+		{
+			m_pollMutex->Unlock();
+			continue;
+		}
 
-				ReleaseNodes();
-			}
+		// Take the value which is due first, and put it back in for its next poll.
+		// It keeps to its cadence unless it has fallen a whole interval behind.
+		PollSchedule::iterator pit = m_pollSchedule.begin();
+		ValueID valueId = pit->second;
+		uint64 due = pit->first;
+		m_pollSchedule.erase( pit );
 
+		// call GetNode to ensure the node objects are locked during this period
+		(void)GetNode( valueId.GetNodeId() );
+		Value* value = GetValue( valueId );
+		if( !value )
+		{
+			// The value has gone, along with its node
+			m_pollIndex.erase( valueId );
+			ReleaseNodes();
 			m_pollMutex->Unlock();
+			continue;
+		}
+		uint64 interval = (uint64)GetValuePollInterval( value ) * 1000;
+		value->Release();
+		ReleaseNodes();
 
-			// Polling messages are only sent when there are no other messages waiting to be sent
-			// While this makes the polls much more variable and uncertain if some other activity dominates
-			// a send queue, that may be appropriate
-			// TODO we can have a debate about whether to test all four queues or just the Poll queue
-			// Wait until the library isn't actively sending messages (or in the midst of a transaction)
-			int i32;
-			int loopCount = 0;
-			while( !m_msgQueue[MsgQueue_Poll].empty()
-				|| !m_msgQueue[MsgQueue_Send].empty()
-				|| !m_msgQueue[MsgQueue_Command].empty()
-				|| !m_msgQueue[MsgQueue_Query].empty()
-				|| m_currentMsg != NULL )
-			{
-				i32 = Wait::Single( _exitEvent, 10);		// test conditions every 10ms
-				if( i32 == 0 )
-				{
-					// Exit has been called
-					return;
-				}
-				loopCount++;
-				if( loopCount == 3000*10 )		// 300 seconds worth of delay?  Something unusual is going on
+		uint64 now = TimeStamp::GetMonotonic();
+		uint64 next = due + interval;
+		if( next < now )
+		{
+			next = now + interval;
+		}
+		m_pollIndex[valueId] = m_pollSchedule.insert( PollSchedule::value_type( next, valueId ) );
+		lastPoll = now;
+
+		// Request the state of the value from the node to which it belongs
+		if( Node* node = GetNode( valueId.GetNodeId() ) )
+		{
+			bool requestState = true;
+			if( !node->IsListeningDevice() )
+			{
+				// The device is not awake all the time.  If it is not awake, we mark it
+				// as requiring a poll.  The poll will be done next time the node wakes up.
+				if( WakeUp* wakeUp = static_cast<WakeUp*>( node->GetCommandClass( WakeUp::StaticGetCommandClassId() ) ) )
 				{
-					Log::Write( LogLevel_Warning, "Poll queue hasn't been able to execute for 300 secs or more" );
-					Log::QueueDump();
-//					assert( 0 );
+					if( !wakeUp->IsAwake() )
+					{
+						wakeUp->SetPollRequired();
+						requestState = false;
+					}
 				}
 			}
 
-			// ready for next poll...insert the pollInterval delay
-			i32 = Wait::Single( _exitEvent, pollInterval );
-			if( i32 == 0 )
+			if( requestState )
 			{
-				// Exit has been called
-				return;
-			}
-		}
-		else		// poll list is empty or awake nodes haven't been fully queried yet
-		{
-			// don't poll just yet, wait for the pollInterval or exit before re-checking to see if the pollList has elements
-			int32 i32 = Wait::Single( _exitEvent, 500 );
-			if( i32 == 0 )
-			{
-				// Exit has been called
-				return;
+				// Request an update of the value
+				CommandClass* cc = node->GetCommandClass( valueId.GetCommandClassId() );
+				if (cc) {
+					uint8 index = valueId.GetIndex();
+					uint8 instance = valueId.GetInstance();
+					OZW_LOG_CC( LogLevel_Detail, node->m_nodeId, cc->GetCommandClassId(), "Polling: %s index = %d instance = %d (poll queue has %d messages)", cc->GetCommandClassName().c_str(), index, instance, m_msgQueue[MsgQueue_Poll].size() );
+					cc->RequestValue( 0, index, instance, MsgQueue_Poll );
+				}
 			}
+
+			ReleaseNodes();
 		}
+
+		m_pollMutex->Unlock();
 	}
 }
 
@@ -5512,6 +6559,14 @@ void Driver::QueueNotification
 	Notification* _notification
 )
 {
+	if( m_inFrame )
+	{
+		_notification->SetTimes( m_frameReadTime, m_frameTime, TimeStamp::GetMonotonic() );
+	}
+	else
+	{
+		_notification->SetTimes( 0, 0, TimeStamp::GetMonotonic() );
+	}
 	m_notifications.push_back( _notification );
 	m_notificationsEvent->Set();
 }
@@ -5703,7 +6758,7 @@ void Driver::SendVirtualNodeInfo
 	char str[80];
 
 	snprintf( str, sizeof(str), "Send Virtual Node Info from %d to %d", _FromNodeId, _ToNodeId );
-	Msg* msg = new Msg( str, 0xff, REQUEST, FUNC_ID_ZW_SEND_SLAVE_NODE_INFO, true );
+	Msg* msg = new Msg( string( str ), 0xff, REQUEST, FUNC_ID_ZW_SEND_SLAVE_NODE_INFO, true );
 	msg->Append( _FromNodeId );		// from the virtual node
 	msg->Append( _ToNodeId );		// to the handheld controller
 	msg->Append( TRANSMIT_OPTION_ACK );
@@ -6201,6 +7256,13 @@ void Driver::GetDriverStatistics
 	_data->m_ACKCnt = m_ACKCnt;
 	_data->m_OOFCnt = m_OOFCnt;
 	_data->m_dropped = m_dropped;
+	_data->m_expired = m_expired;
+	_data->m_coalesced = m_coalesced;
+	_data->m_suppressed = m_suppressed;
+	_data->m_savedBytes = m_savedBytes;
+	_data->m_tripped = m_tripped;
+	_data->m_parked = m_parked;
+	_data->m_skippedPolls = m_skippedPolls;
 	_data->m_retries = m_retries;
 	_data->m_callbacks = m_callbacks;
 	_data->m_badroutes = m_badroutes;
@@ -6231,6 +7293,47 @@ void Driver::GetNodeStatistics
 	}
 }
 
+//-----------------------------------------------------------------------------
+// <Driver::GetNodesSnapshot>
+// Copy out the state of every node, holding the node lock just once
+//-----------------------------------------------------------------------------
+void Driver::GetNodesSnapshot
+(
+	vector<Node::NodeSnapshot>* _data
+)
+{
+	LockNodes();
+	for( int i=0; i<256; ++i )
+	{
+		if( m_nodes[i] )
+		{
+			_data->resize( _data->size() + 1 );
+			m_nodes[i]->GetSnapshot( &_data->back() );
+		}
+	}
+	ReleaseNodes();
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::GetValuesSnapshot>
+// Copy out the state of every value of a node
+//-----------------------------------------------------------------------------
+bool Driver::GetValuesSnapshot
+(
+	uint8 const _nodeId,
+	vector<Node::ValueSnapshot>* _data
+)
+{
+	Node* node = GetNode( _nodeId );
+	if( node != NULL )
+	{
+		node->GetValuesSnapshot( _data );
+		ReleaseNodes();
+		return true;
+	}
+	return false;
+}
+
 //-----------------------------------------------------------------------------
 // <Driver::LogDriverStatistics>
 // Report driver statistics to the driver's log
@@ -6274,6 +7377,15 @@ void Driver::LogDriverStatistics
 	Log::Write( LogLevel_Always, "Out of frame data flow errors:  . . . . . . . . . . . . . %ld", data.m_OOFCnt );
 	Log::Write( LogLevel_Always, "Messages retransmitted: . . . . . . . . . . . . . . . . . %ld", data.m_retries );
 	Log::Write( LogLevel_Always, "Messages dropped and not delivered: . . . . . . . . . . . %ld", data.m_dropped );
+	Log::Write( LogLevel_Always, "Messages dropped after their deadline:  . . . . . . . . . %ld", data.m_expired );
+	Log::Write( LogLevel_Always, "Nodes presumed dead and their messages held back: . . . . %ld", data.m_tripped );
+	Log::Write( LogLevel_Always, "Messages held back for dead nodes:  . . . . . . . . . . . %ld", data.m_parked );
+	Log::Write( LogLevel_Always, "*** Savings" );
+	Log::Write( LogLevel_Always, "Queued Sets replaced by a later Set:  . . . . . . . . . . %ld", data.m_coalesced );
+	Log::Write( LogLevel_Always, "Duplicate Gets not sent:  . . . . . . . . . . . . . . . . %ld", data.m_suppressed );
+	Log::Write( LogLevel_Always, "Polls not sent as the value was fresh:  . . . . . . . . . %ld", data.m_skippedPolls );
+	Log::Write( LogLevel_Always, "Bytes not sent: . . . . . . . . . . . . . . . . . . . . . %ld", data.m_savedBytes );
+	Log::Write( LogLevel_Always, "Messages allocated outside the pool:  . . . . . . . . . . %ld", Msg::GetPoolMisses() );
 	Log::Write( LogLevel_Always, "***************************************************************************" );
 }
 
@@ -71,6 +71,7 @@ namespace OpenZWave
 		friend class SceneActivation;
 		friend class WakeUp;
 		friend class Security;
+		friend class DriverBench;		// examples/Benchmarks
 
 	//-----------------------------------------------------------------------------
 	//	Controller Interfaces
@@ -138,6 +139,18 @@ namespace OpenZWave
 		 *  Init() will return false if the serial port could not be opened.
 		 */
 		bool Init( uint32 _attempts );
+		/**
+		 *  Ask the driver thread to close and reopen the controller, keeping all node and value
+		 *  information.  The init sequence is then replayed, and the node list in the controller's
+		 *  init data is compared with the nodes we already know about, so only new nodes are
+		 *  interviewed and missing ones removed.
+		 */
+		void RequestReconnect();
+		/**
+		 *  Close the controller and stop the poll thread, dropping any message in flight.  Called
+		 *  on the driver thread before a reconnect.
+		 */
+		void CloseController();
 
 		/**
 		 * Remove any messages to a node on the queues
@@ -148,6 +161,8 @@ namespace OpenZWave
 		Thread*					m_driverThread;			/**< Thread for reading from the Z-Wave controller, and for creating and managing the other threads for sending, polling etc. */
 		bool					m_exit;					/**< Flag that is set when the application is exiting. */
 		bool					m_init;					/**< Set to true once the driver has been initialised */
+		bool					m_reconnecting;			/**< Set while reopening the controller, until the init data has been received */
+		Event*					m_reconnectEvent;		/**< Signalled to request a reconnect */
 		bool					m_awakeNodesQueried;	/**< Set to true once the driver has polled all awake nodes */
 		bool					m_allNodesQueried;		/**< Set to true once the driver has polled all nodes */
 		bool					m_notifytransactions;
@@ -270,6 +285,7 @@ namespace OpenZWave
 	//-----------------------------------------------------------------------------
 	private:
 		bool ReadMsg();
+		bool ReadFrame( uint8* _frame );
 		void ProcessMsg( uint8* _data );
 
 		void HandleGetVersionResponse( uint8* _data );
@@ -350,21 +366,29 @@ namespace OpenZWave
 		bool DisablePoll( const ValueID &_valueId );
 		bool isPolled( const ValueID &_valueId );
 		void SetPollIntensity( const ValueID &_valueId, uint8 _intensity );
+		void SetPollInterval( const ValueID &_valueId, uint32 _milliseconds );
 		static void PollThreadEntryPoint( Event* _exitEvent, void* _context );
 		void PollThreadProc( Event* _exitEvent );
+		uint32 GetValuePollInterval( Value const* _value );					// How often a value is polled, in milliseconds
+		void SchedulePoll( ValueID const& _valueId, uint32 _interval );				// Add a value to the poll schedule, or bring it forward.  Must be called with m_pollMutex held
+		bool IsPollIdle()const;									// True when nothing else is waiting to be sent, so a poll may go
+		bool SkipFreshPoll();									// Reschedule the value due first without polling it if it was refreshed recently
 
 		Thread*					m_pollThread;								// Thread for polling devices on the Z-Wave network
-		struct PollEntry
-		{
-			ValueID	m_id;
-			uint8	m_pollCounter;
-		};
+
+		// Polled values in the order they are due, keyed by monotonic time in us,
+		// with an index so that a value can be found without searching.
+		typedef multimap<uint64, ValueID> PollSchedule;
 OPENZWAVE_EXPORT_WARNINGS_OFF
-		list<PollEntry>			m_pollList;									// List of nodes that need to be polled
+		PollSchedule				m_pollSchedule;
+		map<ValueID, PollSchedule::iterator>	m_pollIndex;
 OPENZWAVE_EXPORT_WARNINGS_ON
 		Mutex*					m_pollMutex;								// Serialize access to the polling list
 		int32					m_pollInterval;								// Time interval during which all nodes must be polled
 		bool					m_bIntervalBetweenPolls;					// if true, the library intersperses m_pollInterval between polls; if false, the library attempts to complete all polls within m_pollInterval
+		Event*					m_pollEvent;								// Signalled when the poll schedule changes
+		Event*					m_pollIdleEvent;							// Signalled by the driver thread when it has nothing else to send
+		int32					m_freshPollPercent;							// A value refreshed within this percentage of its poll interval is not polled
 
 	//-----------------------------------------------------------------------------
 	//	Retrieving Node information
@@ -618,6 +642,8 @@ OPENZWAVE_EXPORT_WARNINGS_ON
 		 *  m_waitingForAck, Msg::GetSendAttempts, Node::AdvanceQueries, GetCurrentNodeQuery,
 		 *  RemoveNodeQuery, Node::AllQueriesCompleted
 		 */
+		bool CoalesceMsg( Msg* _msg, MsgQueue const _queue );						// Merges a new message with an equivalent one already queued, returning true if it has been taken care of.
+		int32 GetRetryTimeout( int32 const _min, int32 const _max );					// Works out how long to wait for the current message before retrying it.
 		bool WriteNextMsg( MsgQueue const _queue );							// Extracts the first message from the queue, and makes it the current one.
 		bool WriteMsg( string const &str);									// Sends the current message to the Z-Wave network
 		void RemoveCurrentMsg();											// Deletes the current message and cleans up the callback etc states
@@ -677,7 +703,9 @@ OPENZWAVE_EXPORT_WARNINGS_ON
 				m_nodeId(0),
 				m_queryStage(Node::QueryStage_None),
 				m_retry(false),
-				m_cci(NULL)
+				m_cci(NULL),
+				m_queuedTime(0),
+				m_queue(MsgQueue_Send)
 		  	{}
 
 			bool operator == ( MsgQueueItem const& _other )const
@@ -707,13 +735,62 @@ OPENZWAVE_EXPORT_WARNINGS_ON
 			Node::QueryStage		m_queryStage;
 			bool				m_retry;
 			ControllerCommandItem*		m_cci;
+			uint64				m_queuedTime;		// When the item was queued, for wait statistics
+			MsgQueue			m_queue;		// The queue a held back item goes back to
+		};
+
+		// One of the send queues.  Items are kept in a FIFO per node, and the nodes
+		// with items waiting are served round-robin, so that a node with a lot to
+		// send cannot starve the others.  The item at the front stays there until
+		// it is popped, as controller commands rely on that.
+		class SendQueue
+		{
+		public:
+			SendQueue(): m_size( 0 ){}
+
+			bool empty()const{ return m_size == 0; }
+			size_t size()const{ return m_size; }
+			MsgQueueItem& front(){ return m_nodes[m_active.front()].front(); }
+			void push_back( MsgQueueItem const& _item );
+			void pop_front();
+
+			// Items for a single node, which may be walked and erased from
+			list<MsgQueueItem>& GetNodeItems( uint8 const _nodeId ){ return m_nodes[_nodeId]; }
+			list<MsgQueueItem>::iterator Erase( uint8 const _nodeId, list<MsgQueueItem>::iterator _it );
+
+			static uint8 GetItemNodeId( MsgQueueItem const& _item );
+
+		private:
+			list<MsgQueueItem>	m_nodes[256];
+			list<uint8>		m_active;		// Nodes with items waiting, in service order
+			size_t			m_size;
+
+			// List nodes are moved here when they are finished with, and reused
+			// by splicing them back in, so that a busy queue does not keep
+			// going to the heap.
+			list<MsgQueueItem>	m_freeItems;
+			list<uint8>		m_freeActive;
 		};
 
+		void RecordNodeFailure( Node* _node );								// Count a failure to reach a node, and open its circuit if there have been too many in a row
+		void OpenCircuit( Node* _node );								// Presume a node dead, and hold back its messages until it answers a probe
+		bool CloseCircuit( uint8 const _nodeId );							// A node has answered again, so queue everything held back for it.  True if that included a query stage marker
+		void ParkMsg( MsgQueueItem const& _item, MsgQueue const _queue );				// Hold back a message for a node whose circuit is open, to go back on _queue.  Must be called with m_sendMutex held
+		void ParkCurrentMsg();										// Hold back the message being sent, as its node has stopped answering
+		void SendProbes();										// Send a No Operation to each node whose circuit is open and is due a probe
+
 OPENZWAVE_EXPORT_WARNINGS_OFF
-		list<MsgQueueItem>			m_msgQueue[MsgQueue_Count];
+		SendQueue				m_msgQueue[MsgQueue_Count];
 OPENZWAVE_EXPORT_WARNINGS_ON
 		Event*					m_queueEvent[MsgQueue_Count];				// Events for each queue, which are signalled when the queue is not empty
 		Mutex*					m_sendMutex;						// Serialize access to the queues
+OPENZWAVE_EXPORT_WARNINGS_OFF
+		SendQueue				m_parkedQueue;						// Messages held back for nodes whose circuit is open
+OPENZWAVE_EXPORT_WARNINGS_ON
+		uint32					m_openCircuits;						// Number of nodes whose circuit is open
+		TimeStamp				m_probeTimeStamp;					// When the next probe of such a node is due
+		int32					m_deadNodeThreshold;					// Failures in a row before a node's circuit is opened
+		int32					m_deadNodeProbeInterval;				// Wait before the first probe of a node whose circuit is open
 		Msg*					m_currentMsg;
 		MsgQueue				m_currentMsgQueueSource;			// identifies which queue held m_currentMsg
 		TimeStamp				m_resendTimeStamp;
@@ -784,6 +861,17 @@ OPENZWAVE_EXPORT_WARNINGS_OFF
 OPENZWAVE_EXPORT_WARNINGS_ON
 		Event*				m_notificationsEvent;
 
+		// Timing of the received message currently being processed, passed on to the notifications it causes.
+		uint64				m_frameReadTime;						// When the start of the frame was received
+		uint64				m_frameTime;							// When the frame had been read and verified
+		bool				m_inFrame;								// Set while ProcessMsg is handling a received frame
+
+		// Data taken from the controller which has not been handled yet.  Complete frames are processed
+		// where they are, and a partial frame waits at the start for the rest of it to arrive.
+		uint8				m_rxBuffer[2048];
+		uint32				m_rxLength;
+		uint64				m_rxPartialTime;						// When the partial frame began to arrive
+
 	//-----------------------------------------------------------------------------
 	//	Statistics
 	//-----------------------------------------------------------------------------
@@ -801,6 +889,13 @@ OPENZWAVE_EXPORT_WARNINGS_ON
 			uint32 m_ACKCnt;			// Number of ACK bytes received
 			uint32 m_OOFCnt;			// Number of bytes out of framing
 			uint32 m_dropped;			// Number of messages dropped & not delivered
+			uint32 m_expired;			// Number of messages dropped because their deadline passed
+			uint32 m_coalesced;			// Number of queued Sets replaced by a later one
+			uint32 m_suppressed;			// Number of Gets dropped as one was already queued
+			uint32 m_savedBytes;			// Number of bytes not sent thanks to the above
+			uint32 m_tripped;			// Number of times a node was presumed dead and its messages held back
+			uint32 m_parked;			// Number of messages held back for such nodes
+			uint32 m_skippedPolls;			// Number of polls not sent as the value had been refreshed recently
 			uint32 m_retries;			// Number of messages retransmitted
 			uint32 m_callbacks;			// Number of unexpected callbacks
 			uint32 m_badroutes;			// Number of failed messages due to bad route response
@@ -818,6 +913,8 @@ OPENZWAVE_EXPORT_WARNINGS_ON
 	private:
 		void GetDriverStatistics( DriverData* _data );
 		void GetNodeStatistics( uint8 const _nodeId, Node::NodeData* _data );
+		void GetNodesSnapshot( vector<Node::NodeSnapshot>* _data );
+		bool GetValuesSnapshot( uint8 const _nodeId, vector<Node::ValueSnapshot>* _data );
 
 		uint32 m_SOFCnt;			// Number of SOF bytes received
 		uint32 m_ACKWaiting;			// Number of unsolcited messages while waiting for an ACK
@@ -830,6 +927,13 @@ OPENZWAVE_EXPORT_WARNINGS_ON
 		uint32 m_ACKCnt;			// Number of ACK bytes received
 		uint32 m_OOFCnt;			// Number of bytes out of framing
 		uint32 m_dropped;			// Number of messages dropped & not delivered
+		uint32 m_expired;			// Number of messages dropped because their deadline passed
+		uint32 m_coalesced;			// Number of queued Sets replaced by a later one
+		uint32 m_suppressed;			// Number of Gets dropped as one was already queued
+		uint32 m_savedBytes;			// Number of bytes not sent thanks to the above
+		uint32 m_tripped;			// Number of times a node was presumed dead and its messages held back
+		uint32 m_parked;			// Number of messages held back for such nodes
+		uint32 m_skippedPolls;			// Number of polls not sent as the value had been refreshed recently
 		uint32 m_retries;			// Number of retransmitted messages
 		uint32 m_callbacks;			// Number of unexpected callbacks
 		uint32 m_badroutes;			// Number of failed messages due to bad route response
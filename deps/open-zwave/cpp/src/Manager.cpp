@@ -32,6 +32,7 @@
 #include "Defs.h"
 #include "Manager.h"
 #include "Driver.h"
+#include "Msg.h"
 #include "Node.h"
 #include "Notification.h"
 #include "Options.h"
@@ -163,6 +164,7 @@ Manager::Manager
 		Log::Create( logFilename, bAppend, bConsoleOutput, (LogLevel) nSaveLogLevel, (LogLevel) nQueueLogLevel, (LogLevel) nDumpTrigger );
 	Log::SetLoggingState( logging );
 
+	Msg::CreatePool();
 	CommandClasses::RegisterCommandClasses();
 	Scene::ReadScenes();
 	Log::Write(LogLevel_Always, "OpenZwave Version %s Starting Up", getVersionAsString().c_str());
@@ -193,6 +195,7 @@ Manager::~Manager
 	}
 
 	m_notificationMutex->Release();
+	Msg::DestroyPool();
 
 	// Clear the watchers list
 	while( !m_watchers.empty() )
@@ -333,6 +336,37 @@ bool Manager::RemoveDriver
 	return false;
 }
 
+//-----------------------------------------------------------------------------
+// <Manager::ReconnectDriver>
+// Reopen the controller of a driver without losing its state
+//-----------------------------------------------------------------------------
+bool Manager::ReconnectDriver
+(
+	string const& _controllerPath
+)
+{
+	for( list<Driver*>::iterator pit = m_pendingDrivers.begin(); pit != m_pendingDrivers.end(); ++pit )
+	{
+		if( _controllerPath == (*pit)->GetControllerPath() )
+		{
+			(*pit)->RequestReconnect();
+			return true;
+		}
+	}
+
+	for( map<uint32,Driver*>::iterator rit = m_readyDrivers.begin(); rit != m_readyDrivers.end(); ++rit )
+	{
+		if( _controllerPath == rit->second->GetControllerPath() )
+		{
+			rit->second->RequestReconnect();
+			return true;
+		}
+	}
+
+	Log::Write( LogLevel_Info, "mgr,     Failed to reconnect driver for controller %s", _controllerPath.c_str() );
+	return false;
+}
+
 //-----------------------------------------------------------------------------
 // <Manager::GetDriver>
 // Get a pointer to the driver for a Z-Wave PC Interface
@@ -705,6 +739,24 @@ void Manager::SetPollIntensity
 	Log::Write( LogLevel_Error, "mgr,     SetPollIntensity failed - Driver with Home ID 0x%.8x is not available", _valueId.GetHomeId() );
 }
 
+//-----------------------------------------------------------------------------
+// <Manager::SetPollInterval>
+// Change how often this value is polled
+//-----------------------------------------------------------------------------
+void Manager::SetPollInterval
+(
+	ValueID const &_valueId,
+	uint32 const _milliseconds
+)
+{
+	if( Driver* driver = GetDriver( _valueId.GetHomeId() ) )
+	{
+		return( driver->SetPollInterval( _valueId, _milliseconds ) );
+	}
+
+	Log::Write( LogLevel_Error, "mgr,     SetPollInterval failed - Driver with Home ID 0x%.8x is not available", _valueId.GetHomeId() );
+}
+
 //-----------------------------------------------------------------------------
 // <Manager::GetPollIntensity>
 // Change the intensity with which this value is polled
@@ -729,6 +781,30 @@ uint8 Manager::GetPollIntensity
  	return intensity;
 }
 
+//-----------------------------------------------------------------------------
+// <Manager::GetPollInterval>
+// Get how often this value is polled, if it has an interval of its own
+//-----------------------------------------------------------------------------
+uint32 Manager::GetPollInterval
+(
+	ValueID const &_valueId
+)
+{
+	uint32 interval = 0;
+	if( Driver* driver = GetDriver( _valueId.GetHomeId() ) )
+	{
+		driver->LockNodes();
+		if( Value* value = driver->GetValue( _valueId ) )
+		{
+			interval = value->GetPollInterval();
+			value->Release();
+		}
+		driver->ReleaseNodes();
+	}
+
+	return interval;
+}
+
 //-----------------------------------------------------------------------------
 //	Retrieving Node information
 //-----------------------------------------------------------------------------
@@ -4048,3 +4124,41 @@ void Manager::GetNodeStatistics
 	}
 
 }
+
+//-----------------------------------------------------------------------------
+// <Manager::GetNodesSnapshot>
+// Retrieve the state of every node in one pass.
+//-----------------------------------------------------------------------------
+bool Manager::GetNodesSnapshot
+(
+	uint32 const _homeId,
+	vector<Node::NodeSnapshot>* o_nodes
+)
+{
+	if( Driver* driver = GetDriver( _homeId ) )
+	{
+		driver->GetNodesSnapshot( o_nodes );
+		return true;
+	}
+
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+// <Manager::GetValuesSnapshot>
+// Retrieve the state of every value of a node in one pass.
+//-----------------------------------------------------------------------------
+bool Manager::GetValuesSnapshot
+(
+	uint32 const _homeId,
+	uint8 const _nodeId,
+	vector<Node::ValueSnapshot>* o_values
+)
+{
+	if( Driver* driver = GetDriver( _homeId ) )
+	{
+		return driver->GetValuesSnapshot( _nodeId, o_values );
+	}
+
+	return false;
+}
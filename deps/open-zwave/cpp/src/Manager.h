@@ -114,6 +114,7 @@ namespace OpenZWave
 		friend class Value;
 		friend class ValueStore;
 		friend class ValueButton;
+		friend class DriverBench;		// examples/Benchmarks
 
 	public:
 		typedef void (*pfnOnNotification_t)( Notification const* _pNotification, void* _context );
@@ -238,6 +239,18 @@ namespace OpenZWave
 		 */
 		bool RemoveDriver( string const& _controllerPath );
 
+		/**
+		 * \brief Closes and reopens the controller of a driver, keeping all node and value information.
+		 * This is much quicker than removing and re-adding the driver, as neither the configuration nor
+		 * the nodes have to be read again.  Once the controller has been reopened, the node list it reports
+		 * is compared with the known nodes: new nodes are interviewed and missing nodes removed, with the
+		 * usual notifications, but no DriverReset is sent.
+		 * @param _controllerPath The same string as was passed in the original call to AddDriver.
+		 * @returns True if the reconnect was started, false if the driver could not be found.
+		 * @see AddDriver, RemoveDriver
+		 */
+		bool ReconnectDriver( string const& _controllerPath );
+
 		/**
 		 * \brief Get the node ID of the Z-Wave controller.
 		 * \param _homeId The Home ID of the Z-Wave controller.
@@ -410,6 +423,21 @@ OPENZWAVE_EXPORT_WARNINGS_ON
 		 */
 		uint8 GetPollIntensity( ValueID const &_valueId );
 
+		/**
+		 * \brief Set how often a value is polled, rather than working it out from the poll
+		 * interval and intensity.
+		 * \param _valueId The ID of the value whose interval should be set
+		 * \param _milliseconds Time between polls of the value, or zero to go back to the intensity
+		 */
+		void SetPollInterval( ValueID const &_valueId, uint32 const _milliseconds );
+
+		/**
+		 * \brief Get how often a value is polled, if it has an interval of its own.
+		 * \param _valueId The ID of the value to check.
+		 * \return Time between polls of the value in milliseconds, or zero if it uses the intensity.
+		 */
+		uint32 GetPollInterval( ValueID const &_valueId );
+
 	/*@}*/
 
 	//-----------------------------------------------------------------------------
@@ -1916,6 +1944,33 @@ OPENZWAVE_EXPORT_WARNINGS_ON
 		 * \param _data Pointer to structure NodeData to return values
 		 */
 		void GetNodeStatistics( uint32 const _homeId, uint8 const _nodeId, Node::NodeData* _data );
+	/*@}*/
+
+	//-----------------------------------------------------------------------------
+	// Snapshot interface
+	//-----------------------------------------------------------------------------
+	/** \name Snapshot interface
+	 *  Commands for copying out the current state of a network in one pass, rather
+	 *  than through one call (and one lock of the node array) per item.
+	 */
+	/*@{*/
+	public:
+		/**
+		 * \brief Retrieve the current state of every node
+		 * \param _homeId The Home ID of the driver
+		 * \param o_nodes Pointer to a vector which the nodes are appended to
+		 * \return true if the driver was found
+		 */
+		bool GetNodesSnapshot( uint32 const _homeId, vector<Node::NodeSnapshot>* o_nodes );
+
+		/**
+		 * \brief Retrieve the current state of every value of a node
+		 * \param _homeId The Home ID of the driver for the node
+		 * \param _nodeId The node number
+		 * \param o_values Pointer to a vector which the values are appended to
+		 * \return true if the node was found
+		 */
+		bool GetValuesSnapshot( uint32 const _homeId, uint8 const _nodeId, vector<Node::ValueSnapshot>* o_values );
 
 	};
 	/*@}*/
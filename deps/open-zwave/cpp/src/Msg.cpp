@@ -29,16 +29,165 @@
 #include "Msg.h"
 #include "Node.h"
 #include "platform/Log.h"
+#include "platform/Mutex.h"
 #include "command_classes/MultiInstance.h"
 
 using namespace OpenZWave;
 
 uint8 Msg::s_nextCallbackId = 1;
 
+// Set commands which leave the whole state of a value behind, so that a
+// later Set to the same node and instance makes an earlier one pointless.
+// Some are only the same if their first parameter (the setpoint type, or
+// the configuration parameter) matches as well.
+static struct
+{
+	uint8	m_commandClassId;
+	uint8	m_command;
+	uint8	m_keyBytes;
+}
+const c_coalescableSets[] =
+{
+	{ 0x20, 0x01, 0 },		// Basic Set
+	{ 0x25, 0x01, 0 },		// Switch Binary Set
+	{ 0x26, 0x01, 0 },		// Switch Multilevel Set
+	{ 0x40, 0x01, 0 },		// Thermostat Mode Set
+	{ 0x43, 0x01, 1 },		// Thermostat Setpoint Set
+	{ 0x44, 0x01, 0 },		// Thermostat Fan Mode Set
+	{ 0x62, 0x01, 0 },		// Door Lock Operation Set
+	{ 0x70, 0x04, 1 },		// Configuration Set
+	{ 0x75, 0x01, 0 },		// Protection Set
+	{ 0x76, 0x01, 0 },		// Lock Set
+	{ 0x87, 0x01, 0 }		// Indicator Set
+};
+
+// Messages are created and deleted for every poll, refresh and retry, so
+// they are taken from a fixed pool rather than the heap.  Once the pool is
+// exhausted, or before it has been created, the heap is used instead.
+static uint32 const c_msgPoolSize = 256;
+
+union MsgSlot
+{
+	MsgSlot*	m_next;
+	uint64		m_align;
+	uint8		m_data[sizeof(Msg)];
+};
+
+static MsgSlot		s_msgPool[c_msgPoolSize];
+static MsgSlot*		s_msgFree = NULL;
+static Mutex*		s_msgPoolMutex = NULL;
+static uint32		s_msgPoolMisses = 0;
+
+//-----------------------------------------------------------------------------
+// <Msg::CreatePool>
+// Set up the pool of messages, before any driver is started
+//-----------------------------------------------------------------------------
+void Msg::CreatePool
+(
+)
+{
+	if( s_msgPoolMutex != NULL )
+	{
+		return;
+	}
+
+	s_msgFree = NULL;
+	for( uint32 i=c_msgPoolSize; i>0; --i )
+	{
+		s_msgPool[i-1].m_next = s_msgFree;
+		s_msgFree = &s_msgPool[i-1];
+	}
+	s_msgPoolMisses = 0;
+	s_msgPoolMutex = new Mutex();
+}
+
+//-----------------------------------------------------------------------------
+// <Msg::DestroyPool>
+// Stop using the pool, once all of the drivers have gone
+//-----------------------------------------------------------------------------
+void Msg::DestroyPool
+(
+)
+{
+	if( s_msgPoolMutex == NULL )
+	{
+		return;
+	}
+
+	s_msgPoolMutex->Release();
+	s_msgPoolMutex = NULL;
+	s_msgFree = NULL;
+}
+
+//-----------------------------------------------------------------------------
+// <Msg::GetPoolMisses>
+// Number of messages which have had to be allocated from the heap
+//-----------------------------------------------------------------------------
+uint32 Msg::GetPoolMisses
+(
+)
+{
+	return s_msgPoolMisses;
+}
+
+//-----------------------------------------------------------------------------
+// <Msg::operator new>
+// Take a message from the pool if possible
+//-----------------------------------------------------------------------------
+void* Msg::operator new
+(
+	size_t _size
+)
+{
+	if( ( s_msgPoolMutex != NULL ) && ( _size == sizeof(Msg) ) )
+	{
+		s_msgPoolMutex->Lock();
+		MsgSlot* slot = s_msgFree;
+		if( slot != NULL )
+		{
+			s_msgFree = slot->m_next;
+		}
+		else
+		{
+			++s_msgPoolMisses;
+		}
+		s_msgPoolMutex->Unlock();
+
+		if( slot != NULL )
+		{
+			return slot;
+		}
+	}
+	return ::operator new( _size );
+}
+
+//-----------------------------------------------------------------------------
+// <Msg::operator delete>
+// Return a message to the pool, or the heap if it came from there
+//-----------------------------------------------------------------------------
+void Msg::operator delete
+(
+	void* _p
+)
+{
+	MsgSlot* slot = static_cast<MsgSlot*>( _p );
+	if( ( slot >= s_msgPool ) && ( slot < s_msgPool + c_msgPoolSize ) )
+	{
+		if( s_msgPoolMutex != NULL )
+		{
+			s_msgPoolMutex->Lock();
+			slot->m_next = s_msgFree;
+			s_msgFree = slot;
+			s_msgPoolMutex->Unlock();
+		}
+		return;
+	}
+	::operator delete( _p );
+}
 
 //-----------------------------------------------------------------------------
 // <Msg::Msg>
-// Constructor
+// Constructor, for a log text which has been built up and must be copied
 //-----------------------------------------------------------------------------
 Msg::Msg
 ( 
@@ -51,20 +200,42 @@ Msg::Msg
 	uint8 const _expectedReply,			// = 0
 	uint8 const _expectedCommandClassId	// = 0
 ):
-	m_logText( _logText ),
-	m_bFinal( false ),
-	m_bCallbackRequired( _bCallbackRequired ),
-	m_callbackId( 0 ),
-	m_expectedReply( 0 ),
-	m_expectedCommandClassId( _expectedCommandClassId ),
-	m_length( 4 ),
-	m_targetNodeId( _targetNodeId ),
-	m_sendAttempts( 0 ),
-	m_maxSendAttempts( MAX_TRIES ),
-	m_instance( 1 ),
-	m_endPoint( 0 ),
-	m_flags( 0 )
+	m_logTextCopy( _logText ),
+	m_logText( m_logTextCopy.c_str() )
 {
+	Init( _targetNodeId, _msgType, _function, _bCallbackRequired, _bReplyRequired, _expectedReply, _expectedCommandClassId );
+}
+
+//-----------------------------------------------------------------------------
+// <Msg::Init>
+// Common part of the constructors
+//-----------------------------------------------------------------------------
+void Msg::Init
+( 
+	uint8 _targetNodeId,
+	uint8 const _msgType,
+	uint8 const _function,
+	bool const _bCallbackRequired,
+	bool const _bReplyRequired,
+	uint8 const _expectedReply,
+	uint8 const _expectedCommandClassId
+)
+{
+	m_bFinal = false;
+	m_bCallbackRequired = _bCallbackRequired;
+	m_callbackId = 0;
+	m_expectedReply = 0;
+	m_expectedCommandClassId = _expectedCommandClassId;
+	m_length = 4;
+	m_targetNodeId = _targetNodeId;
+	m_sendAttempts = 0;
+	m_maxSendAttempts = MAX_TRIES;
+	m_deadline = 0;
+	m_instance = 1;
+	m_endPoint = 0;
+	m_flags = 0;
+	m_setKey = 0;
+
 	if( _bReplyRequired )
 	{
 		// Wait for this message before considering the transaction complete 
@@ -138,6 +309,23 @@ void Msg::Finalize()
 		return;
 	}
 
+	// Note whether this is a Set which a later one can replace, before
+	// any encapsulation moves the command class along the buffer.
+	if( ( m_buffer[3] == FUNC_ID_ZW_SEND_DATA ) && ( m_length > 7 ) )
+	{
+		for( uint32 i=0; i<sizeof(c_coalescableSets)/sizeof(c_coalescableSets[0]); ++i )
+		{
+			if( ( m_buffer[6] == c_coalescableSets[i].m_commandClassId ) && ( m_buffer[7] == c_coalescableSets[i].m_command ) )
+			{
+				if( m_buffer[5] >= 2 + c_coalescableSets[i].m_keyBytes )
+				{
+					m_setKey = ( (uint32)m_buffer[6] << 16 ) | ( (uint32)m_buffer[7] << 8 ) | ( c_coalescableSets[i].m_keyBytes ? m_buffer[8] : 0 );
+				}
+				break;
+			}
+		}
+	}
+
 	// Deal with Multi-Channel/Instance encapsulation
 	if( ( m_flags & ( m_MultiChannel | m_MultiInstance ) ) != 0 )
 	{
@@ -176,6 +364,39 @@ void Msg::Finalize()
 }
 
 
+//-----------------------------------------------------------------------------
+// <Msg::IsSameSet>
+// Whether this and another message set the same state on the same node
+//-----------------------------------------------------------------------------
+bool Msg::IsSameSet
+(
+	Msg const& _other
+)const
+{
+	return( ( m_setKey != 0 )
+		&& ( m_setKey == _other.m_setKey )
+		&& ( m_targetNodeId == _other.m_targetNodeId )
+		&& ( m_instance == _other.m_instance )
+		&& ( m_endPoint == _other.m_endPoint )
+		&& ( m_flags == _other.m_flags ) );
+}
+
+//-----------------------------------------------------------------------------
+// <Msg::IsSameGet>
+// Whether this and another message request the same report from a node
+//-----------------------------------------------------------------------------
+bool Msg::IsSameGet
+(
+	Msg const& _other
+)const
+{
+	return( ( m_expectedReply == FUNC_ID_APPLICATION_COMMAND_HANDLER )
+		&& ( _other.m_expectedReply == FUNC_ID_APPLICATION_COMMAND_HANDLER )
+		&& ( m_targetNodeId == _other.m_targetNodeId )
+		&& ( m_length == _other.m_length )
+		&& ( *this == _other ) );
+}
+
 //-----------------------------------------------------------------------------
 // <Msg::UpdateCallbackId>
 // If this message has a callback ID, increment it and recalculate the checksum
@@ -260,8 +481,9 @@ void Msg::MultiEncap
 		m_buffer[9] = m_endPoint;
 		m_length += 4;
 
-		snprintf( str, sizeof(str), "MultiChannel Encapsulated (instance=%d): %s", m_instance, m_logText.c_str() );
-		m_logText = str;
+		snprintf( str, sizeof(str), "MultiChannel Encapsulated (instance=%d): %s", m_instance, m_logText );
+		m_logTextCopy = str;
+		m_logText = m_logTextCopy.c_str();
 	}
 	else
 	{
@@ -277,7 +499,8 @@ void Msg::MultiEncap
 		m_buffer[8] = m_instance;
 		m_length += 3;
 
-		snprintf( str, sizeof(str), "MultiInstance Encapsulated (instance=%d): %s", m_instance, m_logText.c_str() );
-		m_logText = str;
+		snprintf( str, sizeof(str), "MultiInstance Encapsulated (instance=%d): %s", m_instance, m_logText );
+		m_logTextCopy = str;
+		m_logText = m_logTextCopy.c_str();
 	}
 }
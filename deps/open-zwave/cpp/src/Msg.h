@@ -32,6 +32,7 @@
 #include <string>
 #include <string.h>
 #include "Defs.h"
+#include "platform/TimeStamp.h"
 
 namespace OpenZWave
 {
@@ -48,9 +49,44 @@ namespace OpenZWave
 			m_MultiInstance			= 0x02,		// Indicate MultiInstance encapsulation
 		};
 
+		/**
+		 * \brief Create a message with a string literal as its log text.  The text is not copied.
+		 * Text built up in a local buffer must be passed as a string, so that it is copied.
+		 */
+		template<size_t N>
+		Msg( char const (&_logtext)[N], uint8 _targetNodeId, uint8 const _msgType, uint8 const _function, bool const _bCallbackRequired, bool const _bReplyRequired = true, uint8 const _expectedReply = 0, uint8 const _expectedCommandClassId = 0 ):
+			m_logText( _logtext )
+		{
+			Init( _targetNodeId, _msgType, _function, _bCallbackRequired, _bReplyRequired, _expectedReply, _expectedCommandClassId );
+		}
+
+		/**
+		 * \brief Create a message with a log text which has been built up, and is copied.
+		 */
 		Msg( string const& _logtext, uint8 _targetNodeId, uint8 const _msgType, uint8 const _function, bool const _bCallbackRequired, bool const _bReplyRequired = true, uint8 const _expectedReply = 0, uint8 const _expectedCommandClassId = 0 );
 		~Msg(){}
 
+		/**
+		 * \brief Messages come from a fixed pool while it exists, and from the heap otherwise.
+		 */
+		static void* operator new( size_t _size );
+		static void operator delete( void* _p );
+
+		/**
+		 * \brief Create the pool of messages.  Called by the Manager before any driver is started.
+		 */
+		static void CreatePool();
+
+		/**
+		 * \brief Stop using the pool of messages.  Called by the Manager once all drivers are gone.
+		 */
+		static void DestroyPool();
+
+		/**
+		 * \brief Number of messages allocated from the heap because the pool was exhausted.
+		 */
+		static uint32 GetPoolMisses();
+
 		void SetInstance( CommandClass* _cc, uint8 const _instance );	// Used to enable wrapping with MultiInstance/MultiChannel during finalize.
 
 		void Append( uint8 const _data );
@@ -115,6 +151,33 @@ namespace OpenZWave
 		uint8 GetMaxSendAttempts()const{ return m_maxSendAttempts; }
 		void SetMaxSendAttempts( uint8 _count ){ if( _count < MAX_MAX_TRIES ) m_maxSendAttempts = _count; }
 
+		/**
+		 * \brief Set a deadline for the message.  If it is still queued once the deadline
+		 * has passed, it is dropped rather than sent.
+		 * \param _timeout milliseconds from now, or zero for no deadline.
+		 */
+		void SetDeadline( uint32 const _timeout ){ m_deadline = _timeout ? TimeStamp::GetMonotonic() + ( (uint64)_timeout * 1000 ) : 0; }
+		bool HasDeadline()const{ return m_deadline != 0; }
+		bool IsExpired()const{ return m_deadline != 0 && TimeStamp::GetMonotonic() > m_deadline; }
+
+		/**
+		 * \brief Take the deadline of another message, or none if it has none.  Used when this
+		 * message takes the other's place in a queue.
+		 */
+		void TakeDeadline( Msg const& _other ){ m_deadline = _other.m_deadline; }
+
+		/**
+		 * \brief Whether this message is a Set which leaves the same value on the node as _other does,
+		 * so that only the later of the two needs to be sent.  Both must have been finalized.
+		 */
+		bool IsSameSet( Msg const& _other )const;
+
+		/**
+		 * \brief Whether this message is a Get which asks the node for the same report as _other.
+		 * Both must have been finalized.
+		 */
+		bool IsSameGet( Msg const& _other )const;
+
 		bool IsWakeUpNoMoreInformationCommand()
 		{
 			return( m_bFinal && (m_length==11) && (m_buffer[3]==0x13) && (m_buffer[6]==0x84) && (m_buffer[7]==0x08) );
@@ -123,6 +186,11 @@ namespace OpenZWave
 		{
 			return( m_bFinal && (m_length==11) && (m_buffer[3]==0x13) && (m_buffer[6]==0x00) && (m_buffer[7]==0x00) );
 		}
+		bool CarriesNonce()
+		{
+			// Security Nonce Report and Message Encapsulation, which are no good once the nonce has expired
+			return( m_bFinal && (m_length>8) && (m_buffer[3]==0x13) && (m_buffer[6]==0x98) && ( (m_buffer[7]==0x80) || (m_buffer[7]==0x81) || (m_buffer[7]==0xc1) ) );
+		}
 
 		bool operator == ( Msg const& _other )const
 		{
@@ -144,9 +212,16 @@ namespace OpenZWave
 		}
 
 	private:
+		Msg( Msg const& );					// prevent copy
+		Msg& operator = ( Msg const& );				// prevent assignment
+		template<size_t N>
+		Msg( char (&_logtext)[N], uint8 _targetNodeId, uint8 const _msgType, uint8 const _function, bool const _bCallbackRequired, bool const _bReplyRequired = true, uint8 const _expectedReply = 0, uint8 const _expectedCommandClassId = 0 );	// prevent keeping a pointer to a local buffer
+
+		void Init( uint8 _targetNodeId, uint8 const _msgType, uint8 const _function, bool const _bCallbackRequired, bool const _bReplyRequired, uint8 const _expectedReply, uint8 const _expectedCommandClassId );
 		void MultiEncap();					// Encapsulate the data inside a MultiInstance/Multicommand message
 
-		string			m_logText;
+		string			m_logTextCopy;			// Only used when the log text had to be copied
+		char const*		m_logText;
 		bool			m_bFinal;
 		bool			m_bCallbackRequired;
 
@@ -159,10 +234,12 @@ namespace OpenZWave
 		uint8			m_targetNodeId;
 		uint8			m_sendAttempts;
 		uint8			m_maxSendAttempts;
+		uint64			m_deadline;			// Monotonic time in us after which the message is not sent, or 0
 
 		uint8			m_instance;
 		uint8			m_endPoint;			// Endpoint to use if the message must be wrapped in a multiInstance or multiChannel command class
 		uint8			m_flags;
+		uint32			m_setKey;			// Command class, command and key parameter of a Set which may be coalesced, or 0
 
 		static uint8		s_nextCallbackId;		// counter to get a unique callback id
 	};
@@ -151,9 +151,19 @@ Node::Node
 	m_lastResponseRTT( 0 ),
 	m_averageRequestRTT( 0 ),
 	m_averageResponseRTT( 0 ),
+	m_smoothedRequestRTT( 0 ),
+	m_requestRTTVariance( 0 ),
+	m_smoothedResponseRTT( 0 ),
+	m_responseRTTVariance( 0 ),
+	m_retryBackoff( 0 ),
+	m_lastQueueWait( 0 ),
+	m_averageQueueWait( 0 ),
+	m_maxQueueWait( 0 ),
 	m_quality( 0 ),
 	m_lastReceivedMessage(),
-	m_errors( 0 )
+	m_errors( 0 ),
+	m_circuitOpen( false ),
+	m_probeBackoff( 0 )
 {
 	memset( m_neighbors, 0, sizeof(m_neighbors) );
 	memset( m_routeNodes, 0, sizeof(m_routeNodes) );
@@ -1415,7 +1425,11 @@ void Node::SetNodeAlive
 		Log::Write( LogLevel_Error, m_nodeId, "WARNING: node revived" );
 		m_nodeAlive = true;
 		m_errors = 0;
-		if( m_queryStage != Node::QueryStage_Complete )
+		// Send everything which was held back while the node was not answering.
+		// If that included the marker for a query stage, the stage is still
+		// under way and must not be advanced a second time.
+		bool queryStageQueued = m_circuitOpen && GetDriver()->CloseCircuit( m_nodeId );
+		if( m_queryStage != Node::QueryStage_Complete && !queryStageQueued )
 		{
 			m_queryRetries = 0; // restart at last stage
 			AdvanceQueries();
@@ -2766,6 +2780,13 @@ void Node::GetNodeStatistics
 	_data->m_receivedTS = m_receivedTS.GetAsString();
 	_data->m_averageRequestRTT = m_averageRequestRTT;
 	_data->m_averageResponseRTT = m_averageResponseRTT;
+	_data->m_smoothedRequestRTT = m_smoothedRequestRTT;
+	_data->m_requestRTTVariance = m_requestRTTVariance;
+	_data->m_smoothedResponseRTT = m_smoothedResponseRTT;
+	_data->m_responseRTTVariance = m_responseRTTVariance;
+	_data->m_lastQueueWait = m_lastQueueWait;
+	_data->m_averageQueueWait = m_averageQueueWait;
+	_data->m_maxQueueWait = m_maxQueueWait;
 	_data->m_quality = m_quality;
 	memcpy( _data->m_lastReceivedMessage, m_lastReceivedMessage, sizeof(m_lastReceivedMessage) );
 	for( map<uint8,CommandClass*>::const_iterator it = m_commandClassMap.begin(); it != m_commandClassMap.end(); ++it )
@@ -2778,6 +2799,132 @@ void Node::GetNodeStatistics
 	}
 }
 
+//-----------------------------------------------------------------------------
+// <Node::UpdateRTT>
+// Add a round trip time to the smoothed estimate and its variance, in the
+// same way as TCP (RFC 6298)
+//-----------------------------------------------------------------------------
+void Node::UpdateRTT
+(
+	uint32 const _rtt,
+	bool const _response
+)
+{
+	uint32& srtt = _response ? m_smoothedResponseRTT : m_smoothedRequestRTT;
+	uint32& rttvar = _response ? m_responseRTTVariance : m_requestRTTVariance;
+
+	if( srtt == 0 )
+	{
+		srtt = _rtt ? _rtt : 1;
+		rttvar = _rtt / 2;
+	}
+	else
+	{
+		uint32 delta = ( _rtt > srtt ) ? _rtt - srtt : srtt - _rtt;
+		rttvar = ( ( 3 * rttvar ) + delta ) / 4;
+		srtt = ( ( 7 * srtt ) + _rtt ) / 8;
+		if( srtt == 0 )
+		{
+			srtt = 1;
+		}
+	}
+
+	// A good measurement means the route is working again
+	m_retryBackoff = 0;
+}
+
+//-----------------------------------------------------------------------------
+// <Node::GetRetryTimeout>
+// How long to wait for a request or response before retrying, from the
+// smoothed RTT and its variance, doubled for each timeout since the last
+// good measurement.  Until something has been measured, the maximum is used.
+//-----------------------------------------------------------------------------
+int32 Node::GetRetryTimeout
+(
+	bool const _response,
+	int32 const _min,
+	int32 const _max
+)const
+{
+	uint32 srtt = _response ? m_smoothedResponseRTT : m_smoothedRequestRTT;
+	uint32 rttvar = _response ? m_responseRTTVariance : m_requestRTTVariance;
+
+	if( srtt == 0 )
+	{
+		return _max;
+	}
+
+	// Allow at least 100ms for the variance, as the timer is not that precise
+	uint64 timeout = srtt + ( ( 4 * rttvar > 100 ) ? 4 * rttvar : 100 );
+	timeout <<= m_retryBackoff;
+
+	if( timeout < (uint64)_min )
+	{
+		return _min;
+	}
+	if( timeout > (uint64)_max )
+	{
+		return _max;
+	}
+	return (int32)timeout;
+}
+
+//-----------------------------------------------------------------------------
+// <Node::GetSnapshot>
+// Copy out the current state of the node
+//-----------------------------------------------------------------------------
+void Node::GetSnapshot
+(
+	NodeSnapshot* _data
+)
+{
+	_data->m_nodeId = m_nodeId;
+	_data->m_ready = AllQueriesCompleted();
+	_data->m_alive = m_nodeAlive;
+	_data->m_listening = m_listening;
+	_data->m_type = m_type;
+	_data->m_manufacturerName = m_manufacturerName;
+	_data->m_manufacturerId = m_manufacturerId;
+	_data->m_productName = m_productName;
+	_data->m_productType = m_productType;
+	_data->m_productId = m_productId;
+	_data->m_nodeName = m_nodeName;
+	_data->m_location = m_location;
+	_data->m_numValues = 0;
+	for( ValueStore::Iterator it = m_values->Begin(); it != m_values->End(); ++it )
+	{
+		_data->m_numValues++;
+	}
+	_data->m_averageQueueWait = m_averageQueueWait;
+	_data->m_maxQueueWait = m_maxQueueWait;
+}
+
+//-----------------------------------------------------------------------------
+// <Node::GetValuesSnapshot>
+// Copy out the current state of all of the node's values
+//-----------------------------------------------------------------------------
+void Node::GetValuesSnapshot
+(
+	vector<ValueSnapshot>* _data
+)
+{
+	for( ValueStore::Iterator it = m_values->Begin(); it != m_values->End(); ++it )
+	{
+		Value* value = it->second;
+		ValueSnapshot snap;
+
+		snap.m_id = value->GetID().GetId();
+		snap.m_label = value->GetLabel();
+		snap.m_units = value->GetUnits();
+		snap.m_value = value->GetAsString();
+		snap.m_readOnly = value->IsReadOnly();
+		snap.m_writeOnly = value->IsWriteOnly();
+		snap.m_min = value->GetMin();
+		snap.m_max = value->GetMax();
+		_data->push_back( snap );
+	}
+}
+
 //-----------------------------------------------------------------------------
 // <DeviceClass::DeviceClass>
 // Constructor
@@ -547,6 +547,13 @@ namespace OpenZWave
 			uint32 m_averageRequestRTT;				// ms
 			uint32 m_lastResponseRTT;
 			uint32 m_averageResponseRTT;
+			uint32 m_smoothedRequestRTT;				// ms, as used for the retry timeout
+			uint32 m_requestRTTVariance;
+			uint32 m_smoothedResponseRTT;
+			uint32 m_responseRTTVariance;
+			uint32 m_lastQueueWait;					// ms spent in the send queues
+			uint32 m_averageQueueWait;
+			uint32 m_maxQueueWait;
 			uint8 m_quality;					// Node quality measure
 			uint8 m_lastReceivedMessage[254];
 			list<CommandClassData> m_ccData;
@@ -555,6 +562,9 @@ namespace OpenZWave
 	private:
 		void GetNodeStatistics( NodeData* _data );
 
+		void UpdateRTT( uint32 const _rtt, bool const _response );
+		int32 GetRetryTimeout( bool const _response, int32 const _min, int32 const _max )const;
+
 		uint32 m_sentCnt;				// Number of messages sent from this node.
 		uint32 m_sentFailed;				// Number of sent messages failed
 		uint32 m_retries;				// Number of message retries
@@ -567,9 +577,59 @@ namespace OpenZWave
 		TimeStamp m_receivedTS;				// Last message received time
 		uint32 m_averageRequestRTT;			// Average Request round trip time.
 		uint32 m_averageResponseRTT;			// Average Reponse round trip time.
+		uint32 m_smoothedRequestRTT;			// Smoothed request round trip time, for the retry timeout
+		uint32 m_requestRTTVariance;			// Mean deviation of the request round trip time
+		uint32 m_smoothedResponseRTT;			// Smoothed response round trip time, for the retry timeout
+		uint32 m_responseRTTVariance;			// Mean deviation of the response round trip time
+		uint8 m_retryBackoff;				// Number of times the retry timeout has been doubled since the last good RTT
+		uint32 m_lastQueueWait;				// Time the last message sent waited in the send queues
+		uint32 m_averageQueueWait;			// Average time messages wait in the send queues
+		uint32 m_maxQueueWait;				// Longest time a message has waited in the send queues
 		uint8 m_quality;				// Node quality measure
 		uint8 m_lastReceivedMessage[254];		// Place to hold last received message
 		uint8 m_errors;					// Count errors for dead node detection
+		bool m_circuitOpen;				// Presumed dead after failing too often, so messages are held back until a probe is answered
+		uint8 m_probeBackoff;				// Number of times the wait between probes has been doubled
+		TimeStamp m_nextProbe;				// When this node is next due a probe
+
+	//-----------------------------------------------------------------------------
+	//	Snapshot
+	//-----------------------------------------------------------------------------
+	public:
+		struct NodeSnapshot
+		{
+			uint8 m_nodeId;
+			bool m_ready;					// All queries have completed
+			bool m_alive;
+			bool m_listening;
+			string m_type;
+			string m_manufacturerName;
+			string m_manufacturerId;
+			string m_productName;
+			string m_productType;
+			string m_productId;
+			string m_nodeName;
+			string m_location;
+			uint32 m_numValues;
+			uint32 m_averageQueueWait;			// ms
+			uint32 m_maxQueueWait;				// ms
+		};
+
+		struct ValueSnapshot
+		{
+			uint64 m_id;					// As returned by ValueID::GetId()
+			string m_label;
+			string m_units;
+			string m_value;					// As returned by Value::GetAsString()
+			bool m_readOnly;
+			bool m_writeOnly;
+			int32 m_min;
+			int32 m_max;
+		};
+
+	private:
+		void GetSnapshot( NodeSnapshot* _data );
+		void GetValuesSnapshot( vector<ValueSnapshot>* _data );
 	};
 
 } //namespace OpenZWave
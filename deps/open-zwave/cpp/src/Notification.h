@@ -171,8 +171,27 @@ namespace OpenZWave
 		 */
 		uint8 GetByte()const{ return m_byte; }
 
+		/**
+		 * Get when the serial data which led to this notification was received from the controller.
+		 * Times are in microseconds, as returned by TimeStamp::GetMonotonic.
+		 * \return the receive time, or 0 if the notification was not caused by a received message.
+		 */
+		uint64 GetReadTime()const{ return m_readTime; }
+
+		/**
+		 * Get when the message which led to this notification had been completely read and verified.
+		 * \return the frame time, or 0 if the notification was not caused by a received message.
+		 */
+		uint64 GetFrameTime()const{ return m_frameTime; }
+
+		/**
+		 * Get when this notification was queued for the watchers.
+		 * \return the queue time.
+		 */
+		uint64 GetQueueTime()const{ return m_queueTime; }
+
 	private:
-		Notification( NotificationType _type ): m_type( _type ), m_byte(0){}
+		Notification( NotificationType _type ): m_type( _type ), m_byte(0), m_readTime(0), m_frameTime(0), m_queueTime(0){}
 		~Notification(){}
 
 		void SetHomeAndNodeIds( uint32 const _homeId, uint8 const _nodeId ){ m_valueId = ValueID( _homeId, _nodeId ); }
@@ -183,10 +202,14 @@ namespace OpenZWave
 		void SetSceneId( uint8 const _sceneId ){ assert(Type_SceneEvent==m_type); m_byte = _sceneId; }
 		void SetButtonId( uint8 const _buttonId ){ assert(Type_CreateButton==m_type||Type_DeleteButton==m_type||Type_ButtonOn==m_type||Type_ButtonOff==m_type); m_byte = _buttonId; }
 		void SetNotification( uint8 const _noteId ){ assert(Type_Notification==m_type); m_byte = _noteId; }
+		void SetTimes( uint64 const _readTime, uint64 const _frameTime, uint64 const _queueTime ){ m_readTime = _readTime; m_frameTime = _frameTime; m_queueTime = _queueTime; }
 
 		NotificationType		m_type;
 		ValueID				m_valueId;
 		uint8				m_byte;
+		uint64				m_readTime;
+		uint64				m_frameTime;
+		uint64				m_queueTime;
 	};
 
 } //namespace OpenZWave
@@ -121,6 +121,10 @@ Options* Options::Create
 		s_instance->AddOptionString(	"NetworkKey", 				string(""), 			false);
 		s_instance->AddOptionBool(		"RefreshAllUserCodes",		false ); 					// if true, during startup, we refresh all the UserCodes the device reports it supports. If False, we stop after we get the first "Available" slot (Some devices have 250+ usercode slots! - That makes our Session Stage Very Long )
 		s_instance->AddOptionInt( 		"RetryTimeout", 			RETRY_TIMEOUT);				// How long do we wait to timeout messages sent
+		s_instance->AddOptionInt( 		"RetryTimeoutMin", 			RETRY_TIMEOUT_MIN);			// Shortest timeout, when it is worked out from a node's round trip times
+		s_instance->AddOptionInt( 		"DeadNodeThreshold", 		DEAD_NODE_THRESHOLD);		// Failures in a row before a node is presumed dead and its messages are held back, 0 for never
+		s_instance->AddOptionInt( 		"DeadNodeProbeInterval", 	DEAD_NODE_PROBE_INTERVAL);	// How long to wait before probing a dead node, doubling up to 64 times as long
+		s_instance->AddOptionInt( 		"FreshPollPercent", 		FRESH_POLL_PERCENT);		// Skip a poll if the value was refreshed within this percentage of its poll interval, 0 for never
 		s_instance->AddOptionBool( 		"EnableSIS", 				true);						// Automatically become a SUC if there is no SUC on the network.
 		s_instance->AddOptionBool( 		"AssumeAwake", 				true);						// Assume Devices that Support the Wakeup CC are awake when we first query them....
 		s_instance->AddOptionBool(		"NotifyOnDriverUnload",		false);						// Should we send the Node/Value Notifications on Driver Unloading - Read comments in Driver::~Driver() method about possible race conditions
@@ -243,7 +243,7 @@ bool ClimateControlSchedule::HandleMsg
 					char str[64];
 					snprintf( str, 64, "Get climate control schedule for %s", c_dayNames[i] );
 
-					Msg* msg = new Msg( str, GetNodeId(), REQUEST, FUNC_ID_ZW_SEND_DATA, true, true, FUNC_ID_APPLICATION_COMMAND_HANDLER, GetCommandClassId() );
+					Msg* msg = new Msg( string( str ), GetNodeId(), REQUEST, FUNC_ID_ZW_SEND_DATA, true, true, FUNC_ID_APPLICATION_COMMAND_HANDLER, GetCommandClassId() );
 					msg->Append( GetNodeId() );
 					msg->Append( 3 );
 					msg->Append( GetCommandClassId() );
@@ -336,7 +336,7 @@ bool ClimateControlSchedule::SetValue
 		char str[64];
 		snprintf( str, 64, "Set the climate control schedule for %s on node %d", c_dayNames[idx], GetNodeId() );
 
-		Msg* msg = new Msg( str, GetNodeId(), REQUEST, FUNC_ID_ZW_SEND_DATA, true, true, FUNC_ID_APPLICATION_COMMAND_HANDLER, GetCommandClassId() );
+		Msg* msg = new Msg( string( str ), GetNodeId(), REQUEST, FUNC_ID_ZW_SEND_DATA, true, true, FUNC_ID_APPLICATION_COMMAND_HANDLER, GetCommandClassId() );
 		msg->SetInstance( this, instance );
 		msg->Append( GetNodeId() );
 		msg->Append( 30 );
@@ -62,6 +62,70 @@ Log* Log::s_instance = NULL;
 i_LogImpl* Log::m_pImpl = NULL;
 static bool s_dologging;
 
+LogLevel Log::s_logLevel = LogLevel_None;
+LogLevel Log::s_maxLevel = LogLevel_None;
+LogLevel Log::s_nodeLevel[256];
+LogLevel Log::s_commandClassLevel[256];
+static bool s_levelsInitialized = false;
+
+//-----------------------------------------------------------------------------
+//	<Log::InitLevels>
+//	Remove all of the node and command class limits, the first time through
+//-----------------------------------------------------------------------------
+void Log::InitLevels
+(
+)
+{
+	if( !s_levelsInitialized )
+	{
+		for( int i=0; i<256; ++i )
+		{
+			s_nodeLevel[i] = LogLevel_Internal;
+			s_commandClassLevel[i] = LogLevel_Internal;
+		}
+		s_levelsInitialized = true;
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<Log::UpdateMaxLevel>
+//	Work out the least important level which is worth formatting
+//-----------------------------------------------------------------------------
+void Log::UpdateMaxLevel
+(
+)
+{
+	s_maxLevel = ( s_instance && s_dologging && m_pImpl ) ? s_logLevel : LogLevel_None;
+}
+
+//-----------------------------------------------------------------------------
+//	<Log::SetNodeLogLevel>
+//	Limit logging about a node
+//-----------------------------------------------------------------------------
+void Log::SetNodeLogLevel
+(
+	uint8 const _nodeId,
+	LogLevel const _level
+)
+{
+	InitLevels();
+	s_nodeLevel[_nodeId] = _level;
+}
+
+//-----------------------------------------------------------------------------
+//	<Log::SetCommandClassLogLevel>
+//	Limit logging about a command class
+//-----------------------------------------------------------------------------
+void Log::SetCommandClassLogLevel
+(
+	uint8 const _commandClassId,
+	LogLevel const _level
+)
+{
+	InitLevels();
+	s_commandClassLevel[_commandClassId] = _level;
+}
+
 //-----------------------------------------------------------------------------
 //	<Log::Create>
 //	Static creation of the singleton
@@ -80,6 +144,15 @@ Log* Log::Create
 	{
 		s_instance = new Log( _filename, _bAppend, _bConsoleOutput, _saveLevel, _queueLevel, _dumpTrigger );
 		s_dologging = true; // default logging to true so no change to what people experience now
+
+		// Messages less important than all of these are never formatted
+		InitLevels();
+		s_logLevel = _saveLevel;
+		if( _queueLevel > s_logLevel )
+			s_logLevel = _queueLevel;
+		if( _dumpTrigger > s_logLevel )
+			s_logLevel = _dumpTrigger;
+		UpdateMaxLevel();
 	}
 
 	return s_instance;
@@ -116,6 +189,7 @@ void Log::Destroy
 {
 	delete s_instance;
 	s_instance = NULL;
+	UpdateMaxLevel();
 }
 
 //-----------------------------------------------------------------------------
@@ -129,6 +203,7 @@ bool Log::SetLoggingClass
 {
 	delete m_pImpl;
 	m_pImpl = LogClass;
+	UpdateMaxLevel();
 	return true;
 }
 
@@ -149,6 +224,7 @@ void Log::SetLoggingState
 {
 	bool prevLogging = s_dologging;
 	s_dologging = _dologging;
+	UpdateMaxLevel();
 	
 	if (!prevLogging && s_dologging) Log::Write(LogLevel_Always, "Logging started\n\n");
 }
@@ -190,6 +266,13 @@ void Log::SetLoggingState
 		s_instance->m_pImpl->SetLoggingState( _saveLevel, _queueLevel, _dumpTrigger );
 		s_instance->m_logMutex->Unlock();
 	}
+
+	s_logLevel = _saveLevel;
+	if( _queueLevel > s_logLevel )
+		s_logLevel = _queueLevel;
+	if( _dumpTrigger > s_logLevel )
+		s_logLevel = _dumpTrigger;
+	UpdateMaxLevel();
 	
 	if (!prevLogging && s_dologging) Log::Write(LogLevel_Always, "Logging started\n\n");
 }
@@ -216,6 +299,11 @@ void Log::Write
 	...
 )
 {
+	if( ( _level != LogLevel_Internal ) && !IsEnabled( _level ) )
+	{
+		return;
+	}
+
 	if( s_instance && s_dologging && s_instance->m_pImpl )
 	{
 		s_instance->m_logMutex->Lock(); // double locks if recursive
@@ -239,6 +327,11 @@ void Log::Write
 	...
 )
 {
+	if( ( _level != LogLevel_Internal ) && !IsEnabled( _level, _nodeId ) )
+	{
+		return;
+	}
+
 	if( s_instance && s_dologging && s_instance->m_pImpl )
 	{
 		if( _level != LogLevel_Internal )
@@ -164,6 +164,36 @@ namespace OpenZWave
 		 */
 		static void Write( LogLevel _level, uint8 const _nodeId, char const* _format, ... );
 
+		/**
+		 * \brief Determine whether a message would be kept, before going to the trouble of building
+		 * its arguments.  Use it through the OZW_LOG macro, or directly where a message takes some
+		 * work to put together.
+		 * \param _level	The level the message would be written at.
+		 * \param _nodeId	Node Id the message is about, or 0.
+		 * \param _commandClassId	Command class the message is about, or 0.
+		 * \return True if the message would be written or queued.
+		 */
+		static bool IsEnabled( LogLevel const _level, uint8 const _nodeId = 0, uint8 const _commandClassId = 0 )
+		{
+			return( ( _level <= s_maxLevel ) && ( _level <= s_nodeLevel[_nodeId] ) && ( _level <= s_commandClassLevel[_commandClassId] ) );
+		}
+
+		/**
+		 * \brief Limit logging about a node.  Messages about the node which are less important than
+		 * _level are discarded, whatever the other log levels are.
+		 * \param _nodeId	The node.
+		 * \param _level	The least important level to keep, or LogLevel_Internal to remove the limit.
+		 */
+		static void SetNodeLogLevel( uint8 const _nodeId, LogLevel const _level );
+
+		/**
+		 * \brief Limit logging about a command class, in the same way as SetNodeLogLevel.  This only
+		 * applies to messages checked with IsEnabled or OZW_LOG, as Write does not know the command class.
+		 * \param _commandClassId	The command class.
+		 * \param _level	The least important level to keep, or LogLevel_Internal to remove the limit.
+		 */
+		static void SetCommandClassLogLevel( uint8 const _commandClassId, LogLevel const _level );
+
 		/**
 		 * Send the queued log messages to the log output.
 		 */
@@ -178,10 +208,43 @@ namespace OpenZWave
 		Log( string const& _filename, bool const _bAppend, bool const _bConsoleOutput, LogLevel _saveLevel, LogLevel _queueLevel, LogLevel _dumpTrigger );
 		~Log();
 
+		static void InitLevels();
+		static void UpdateMaxLevel();
+
 		static i_LogImpl*	m_pImpl;		/**< Pointer to an object that encapsulates the platform-specific logging implementation. */
 		static Log*	s_instance;
 		Mutex*		m_logMutex;
+
+		static LogLevel	s_logLevel;			/**< Least important level that the implementation saves, queues or dumps on */
+		static LogLevel	s_maxLevel;			/**< s_logLevel while logging, otherwise LogLevel_None */
+		static LogLevel	s_nodeLevel[256];		/**< Per node limits */
+		static LogLevel	s_commandClassLevel[256];	/**< Per command class limits */
 	};
 } // namespace OpenZWave
 
+/**
+ * Write to the log only if the message would be kept, so that the arguments are not evaluated otherwise.
+ * For example OZW_LOG( LogLevel_Detail, nodeId, "Received: %s", msg->GetAsString().c_str() );
+ */
+#define OZW_LOG( _level, _nodeId, ... ) \
+	do \
+	{ \
+		if( OpenZWave::Log::IsEnabled( (_level), (_nodeId) ) ) \
+		{ \
+			OpenZWave::Log::Write( (_level), (_nodeId), __VA_ARGS__ ); \
+		} \
+	} while( 0 )
+
+/**
+ * As OZW_LOG, for a message about a command class.
+ */
+#define OZW_LOG_CC( _level, _nodeId, _commandClassId, ... ) \
+	do \
+	{ \
+		if( OpenZWave::Log::IsEnabled( (_level), (_nodeId), (_commandClassId) ) ) \
+		{ \
+			OpenZWave::Log::Write( (_level), (_nodeId), __VA_ARGS__ ); \
+		} \
+	} while( 0 )
+
 #endif //_Log_H
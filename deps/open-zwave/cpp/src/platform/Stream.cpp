@@ -28,6 +28,7 @@
 #include "platform/Stream.h"
 #include "platform/Mutex.h"
 #include "platform/Log.h"
+#include "platform/TimeStamp.h"
 
 #include <string.h>
 
@@ -48,6 +49,7 @@ Stream::Stream
 	m_dataSize(0),
 	m_head(0),
 	m_tail(0),
+	m_putTime(0),
 	m_mutex( new Mutex() )
 {
 	m_buffer = new uint8[m_bufferSize];
@@ -124,6 +126,20 @@ bool Stream::Get
 	return true;
 }
 
+//-----------------------------------------------------------------------------
+//	<Stream::GetPutTime>
+//	Return when data was last added to the buffer
+//-----------------------------------------------------------------------------
+uint64 Stream::GetPutTime
+(
+)
+{
+	m_mutex->Lock();
+	uint64 putTime = m_putTime;
+	m_mutex->Unlock();
+	return putTime;
+}
+
 //-----------------------------------------------------------------------------
 //	<Stream::Put>
 //	Add data to the buffer
@@ -163,6 +179,7 @@ bool Stream::Put
 	}
 
 	m_dataSize += _size;
+	m_putTime = TimeStamp::GetMonotonic();
 
 	if( IsSignalled() )
 	{
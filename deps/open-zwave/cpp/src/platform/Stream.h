@@ -89,6 +89,13 @@ namespace OpenZWave
 		 */
 		uint32 GetDataSize()const{ return m_dataSize; }
 
+		/**
+		 * Returns when data was last added to the stream.
+		 * \return monotonic time in microseconds, or 0 if nothing has been added.
+		 * \see Put, TimeStamp::GetMonotonic
+		 */
+		uint64 GetPutTime();
+
  		/**
 		 * Empties the stream bytes held in the buffer.  
 		 * This is called when the library gets out of sync with the controller and sends a "NAK" 
@@ -126,6 +133,7 @@ namespace OpenZWave
 		uint32	m_dataSize;
 		uint32	m_head;
 		uint32	m_tail;
+		uint64	m_putTime;
  		Mutex*	m_mutex;
 	};
 
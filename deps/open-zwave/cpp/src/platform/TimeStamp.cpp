@@ -104,3 +104,14 @@ int32 TimeStamp::operator-
 {
 	return (int32)(m_pImpl - _other.m_pImpl);
 }
+
+//-----------------------------------------------------------------------------
+//	<TimeStamp::GetMonotonic>
+//	Return monotonic time in microseconds
+//-----------------------------------------------------------------------------
+uint64 TimeStamp::GetMonotonic
+(
+)
+{
+	return TimeStampImpl::GetMonotonic();
+}
@@ -78,6 +78,13 @@ namespace OpenZWave
 		 */
 		int32 operator- ( TimeStamp const& _other );
 
+		/**
+		 * GetMonotonic.  Gets the time in microseconds from an arbitrary
+		 * point, which is not affected by changes to the system clock.
+		 * \return monotonic time in microseconds.
+		 */
+		static uint64 GetMonotonic();
+
 	private:
 		TimeStamp( TimeStamp const& );					// prevent copy
 		TimeStamp& operator = ( TimeStamp const& );			// prevent assignment
@@ -0,0 +1,105 @@
+//-----------------------------------------------------------------------------
+//
+//	WaitSet.cpp
+//
+//	A fixed set of objects which can be waited on repeatedly
+//
+//	Copyright (c) 2013 Jonathan Perkin <jonathan@perkin.org.uk>
+//	All rights reserved.
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+#include "Defs.h"
+#include "platform/WaitSet.h"
+
+#ifdef __linux__
+#include "platform/unix/WaitSetImpl.h"	// epoll based implementation
+#endif
+
+using namespace OpenZWave;
+
+//-----------------------------------------------------------------------------
+//	<WaitSet::WaitSet>
+//	Constructor
+//-----------------------------------------------------------------------------
+WaitSet::WaitSet
+(
+	OpenZWave::Wait** _objects,
+	uint32 _numObjects
+):
+	m_numObjects( _numObjects ),
+	m_pImpl( NULL )
+{
+	assert( _numObjects <= MaxObjects );
+	if( m_numObjects > MaxObjects )
+	{
+		m_numObjects = MaxObjects;
+	}
+	for( uint32 i=0; i<m_numObjects; ++i )
+	{
+		m_objects[i] = _objects[i];
+	}
+
+#ifdef __linux__
+	m_pImpl = new WaitSetImpl( m_objects, m_numObjects );
+	if( !m_pImpl->IsValid() )
+	{
+		// Out of file descriptors, fall back to Wait::Multiple
+		delete m_pImpl;
+		m_pImpl = NULL;
+	}
+#endif
+}
+
+//-----------------------------------------------------------------------------
+//	<WaitSet::~WaitSet>
+//	Destructor
+//-----------------------------------------------------------------------------
+WaitSet::~WaitSet
+(
+)
+{
+#ifdef __linux__
+	delete m_pImpl;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+//	<WaitSet::Wait>
+//	Wait for one of the objects to become signalled
+//-----------------------------------------------------------------------------
+int32 WaitSet::Wait
+(
+	uint32 _numObjects,
+	int32 _timeout // = -1
+)
+{
+	if( _numObjects > m_numObjects )
+	{
+		_numObjects = m_numObjects;
+	}
+
+#ifdef __linux__
+	if( m_pImpl )
+	{
+		return m_pImpl->Wait( _numObjects, _timeout );
+	}
+#endif
+	return OpenZWave::Wait::Multiple( m_objects, _numObjects, _timeout );
+}
@@ -0,0 +1,81 @@
+//-----------------------------------------------------------------------------
+//
+//	WaitSet.h
+//
+//	A fixed set of objects which can be waited on repeatedly
+//
+//	Copyright (c) 2013 Jonathan Perkin <jonathan@perkin.org.uk>
+//	All rights reserved.
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+#ifndef _WaitSet_H
+#define _WaitSet_H
+
+#include "Defs.h"
+#include "platform/Wait.h"
+
+namespace OpenZWave
+{
+	class WaitSetImpl;
+
+	/** \brief A fixed set of Wait objects, for a thread which waits on the same objects over and over.
+	 *
+	 * Wait::Multiple creates an event and adds and removes a watcher on every object each time it
+	 * is called.  A WaitSet registers with its objects once, when it is created.  Where the platform
+	 * supports it (Linux epoll and eventfd), each object is backed by its own eventfd, and a wait is
+	 * a single epoll_wait.  Elsewhere it falls back to Wait::Multiple.
+	 */
+	class WaitSet
+	{
+	public:
+		enum
+		{
+			MaxObjects = 32
+		};
+
+		/**
+		 * Constructor.
+		 * \param _objects array of pointers to the objects in the set, in priority order.
+		 * \param _numObjects number of objects in the array, no more than MaxObjects.
+		 */
+		WaitSet( OpenZWave::Wait** _objects, uint32 _numObjects );
+		~WaitSet();
+
+		/**
+		 * Wait for one of the first _numObjects objects of the set to become signalled.  As with
+		 * Wait::Multiple, if more than one is signalled, the lowest index is returned.
+		 * \param _numObjects number of objects from the start of the set to wait on.
+		 * \param _timeout maximum time to wait in milliseconds, or -1 to wait forever.
+		 * \return index of the object that was signalled, -1 if the wait timed out.
+		 */
+		int32 Wait( uint32 _numObjects, int32 _timeout = -1 );
+
+	private:
+		WaitSet( WaitSet const& );				// prevent copy
+		WaitSet& operator = ( WaitSet const& );	// prevent assignment
+
+		OpenZWave::Wait*	m_objects[MaxObjects];
+		uint32			m_numObjects;
+		WaitSetImpl*	m_pImpl;				// Platform-specific reactor, or NULL if there is none
+	};
+
+} // namespace OpenZWave
+
+#endif //_WaitSet_H
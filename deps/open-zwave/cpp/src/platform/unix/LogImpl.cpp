@@ -90,14 +90,14 @@ void LogImpl::Write
 	va_list _args
 )
 {
-	// create a timestamp string
-	string timeStr = GetTimeStampString();
-	string nodeStr = GetNodeString( _nodeId );
-	string loglevelStr = GetLogLevelString(_logLevel);
-
 	// handle this message
 	if( (_logLevel <= m_queueLevel) || (_logLevel == LogLevel_Internal) )	// we're going to do something with this message...
 	{
+		// create a timestamp string
+		string timeStr = GetTimeStampString();
+		string nodeStr = GetNodeString( _nodeId );
+		string loglevelStr = GetLogLevelString(_logLevel);
+
 		char lineBuf[1024] = {0};
 		//int lineLen = 0;
 		if( _format != NULL && _format[0] != '\0' )
@@ -30,6 +30,10 @@
 #include "Defs.h"
 #include "TimeStampImpl.h"
 
+#ifdef __APPLE__
+#include <mach/mach_time.h>
+#endif
+
 using namespace OpenZWave;
 
 //-----------------------------------------------------------------------------
@@ -139,3 +143,27 @@ int32 TimeStampImpl::operator-
     
     return diff;  
 }
+
+//-----------------------------------------------------------------------------
+//	<TimeStampImpl::GetMonotonic>
+//	Return monotonic time in microseconds
+//-----------------------------------------------------------------------------
+uint64 TimeStampImpl::GetMonotonic
+(
+)
+{
+#ifdef __APPLE__
+	static mach_timebase_info_data_t timebase;
+
+	if( timebase.denom == 0 )
+	{
+		mach_timebase_info( &timebase );
+	}
+	return ( mach_absolute_time() * timebase.numer / timebase.denom ) / 1000;
+#else
+	struct timespec now;
+
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	return ( (uint64)now.tv_sec * 1000000 ) + ( now.tv_nsec / 1000 );
+#endif
+}
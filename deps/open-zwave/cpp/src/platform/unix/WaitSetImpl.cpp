@@ -0,0 +1,216 @@
+//-----------------------------------------------------------------------------
+//
+//	WaitSetImpl.cpp
+//
+//	Linux implementation of a WaitSet, using epoll and eventfd
+//
+//	Copyright (c) 2013 Jonathan Perkin <jonathan@perkin.org.uk>
+//	All rights reserved.
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+#ifdef __linux__
+
+#include "Defs.h"
+#include "platform/TimeStamp.h"
+#include "WaitSetImpl.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+using namespace OpenZWave;
+
+//-----------------------------------------------------------------------------
+//	<WaitSetImpl::WaitSetImpl>
+//	Constructor
+//-----------------------------------------------------------------------------
+WaitSetImpl::WaitSetImpl
+(
+	OpenZWave::Wait** _objects,
+	uint32 _numObjects
+):
+	m_numObjects( 0 ),
+	m_ready( 0 ),
+	m_epollFd( epoll_create( WaitSet::MaxObjects ) )
+{
+	if( m_epollFd < 0 )
+	{
+		fprintf( stderr, "WaitSetImpl epoll_create error %d\n", errno );
+		return;
+	}
+
+	for( uint32 i=0; i<_numObjects; ++i )
+	{
+		struct epoll_event ev;
+
+		m_slots[i].m_object = _objects[i];
+		m_slots[i].m_eventFd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+		if( m_slots[i].m_eventFd < 0 )
+		{
+			fprintf( stderr, "WaitSetImpl eventfd error %d\n", errno );
+			break;
+		}
+
+		ev.events = EPOLLIN;
+		ev.data.u32 = i;
+		if( epoll_ctl( m_epollFd, EPOLL_CTL_ADD, m_slots[i].m_eventFd, &ev ) < 0 )
+		{
+			fprintf( stderr, "WaitSetImpl epoll_ctl error %d\n", errno );
+			close( m_slots[i].m_eventFd );
+			break;
+		}
+		++m_numObjects;
+
+		// This will write to the eventfd straight away if the object is already signalled
+		m_slots[i].m_object->AddWatcher( WatcherCallback, &m_slots[i] );
+	}
+
+	if( m_numObjects != _numObjects )
+	{
+		// Undo what we managed, so that the caller can fall back
+		for( uint32 i=0; i<m_numObjects; ++i )
+		{
+			m_slots[i].m_object->RemoveWatcher( WatcherCallback, &m_slots[i] );
+			close( m_slots[i].m_eventFd );
+		}
+		m_numObjects = 0;
+		close( m_epollFd );
+		m_epollFd = -1;
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<WaitSetImpl::~WaitSetImpl>
+//	Destructor
+//-----------------------------------------------------------------------------
+WaitSetImpl::~WaitSetImpl
+(
+)
+{
+	for( uint32 i=0; i<m_numObjects; ++i )
+	{
+		m_slots[i].m_object->RemoveWatcher( WatcherCallback, &m_slots[i] );
+		close( m_slots[i].m_eventFd );
+	}
+	if( m_epollFd >= 0 )
+	{
+		close( m_epollFd );
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<WaitSetImpl::WatcherCallback>
+//	Called by an object when it is notified, possibly from another thread
+//-----------------------------------------------------------------------------
+void WaitSetImpl::WatcherCallback
+(
+	void* _context
+)
+{
+	Slot* slot = (Slot*)_context;
+	uint64_t one = 1;
+
+	// Can only fail if the counter would overflow, in which case it is
+	// already readable.
+	if( write( slot->m_eventFd, &one, sizeof(one) ) < 0 )
+	{
+		return;
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<WaitSetImpl::Wait>
+//	Wait for one of the first _numObjects objects to become signalled
+//-----------------------------------------------------------------------------
+int32 WaitSetImpl::Wait
+(
+	uint32 _numObjects,
+	int32 _timeout
+)
+{
+	struct epoll_event events[WaitSet::MaxObjects];
+	uint32 mask = ( _numObjects >= 32 ) ? 0xffffffff : ( ( 1u << _numObjects ) - 1 );
+	uint64 deadline = 0;
+
+	if( _timeout > 0 )
+	{
+		deadline = TimeStamp::GetMonotonic() + ( (uint64)_timeout * 1000 );
+	}
+
+	while( true )
+	{
+		// If anything may already be signalled only poll for new events,
+		// so that a lower index which has just been signalled still wins.
+		bool polled = ( m_ready & mask ) != 0;
+		int32 timeout = polled ? 0 : _timeout;
+		if( !polled && _timeout > 0 )
+		{
+			uint64 now = TimeStamp::GetMonotonic();
+			timeout = ( now >= deadline ) ? 0 : (int32)( ( deadline - now + 999 ) / 1000 );
+		}
+
+		int n = epoll_wait( m_epollFd, events, WaitSet::MaxObjects, timeout );
+		if( n < 0 )
+		{
+			if( errno == EINTR )
+			{
+				continue;
+			}
+			fprintf( stderr, "WaitSetImpl epoll_wait error %d\n", errno );
+			return -1;
+		}
+
+		for( int j=0; j<n; ++j )
+		{
+			uint32 i = events[j].data.u32;
+			uint64_t count;
+
+			// Drain the eventfd, the object itself tells us whether it is still signalled
+			if( read( m_slots[i].m_eventFd, &count, sizeof(count) ) < 0 )
+			{
+				continue;
+			}
+			m_ready |= 1u << i;
+		}
+
+		// Lowest index first, forgetting anything which has since been reset
+		uint32 ready = m_ready & mask;
+		while( ready )
+		{
+			uint32 i = __builtin_ctz( ready );
+			ready &= ready - 1;
+			if( m_slots[i].m_object->IsSignalled() )
+			{
+				return (int32)i;
+			}
+			m_ready &= ~( 1u << i );
+		}
+
+		if( n == 0 && !polled )
+		{
+			// Timed out
+			return -1;
+		}
+	}
+}
+
+#endif // __linux__
@@ -0,0 +1,75 @@
+//-----------------------------------------------------------------------------
+//
+//	WaitSetImpl.h
+//
+//	Linux implementation of a WaitSet, using epoll and eventfd
+//
+//	Copyright (c) 2013 Jonathan Perkin <jonathan@perkin.org.uk>
+//	All rights reserved.
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+#ifndef _WaitSetImpl_H
+#define _WaitSetImpl_H
+
+#include "Defs.h"
+#include "platform/Wait.h"
+#include "platform/WaitSet.h"
+
+namespace OpenZWave
+{
+	/** \brief Linux implementation of a WaitSet.
+	 *
+	 * Each object gets an eventfd, which its watcher writes to whenever the object is
+	 * notified, and all of the eventfds are registered with a single epoll instance.
+	 * Objects are level-triggered (they stay signalled until reset) while eventfds are
+	 * drained once seen, so the objects which were signalled are remembered in m_ready,
+	 * and tested again on the next wait until they are no longer signalled.
+	 */
+	class WaitSetImpl
+	{
+	private:
+		friend class WaitSet;
+
+		WaitSetImpl( OpenZWave::Wait** _objects, uint32 _numObjects );
+		~WaitSetImpl();
+
+		bool IsValid()const{ return m_epollFd >= 0; }
+		int32 Wait( uint32 _numObjects, int32 _timeout );
+
+		static void WatcherCallback( void* _context );
+
+		WaitSetImpl( WaitSetImpl const& );					// prevent copy
+		WaitSetImpl& operator = ( WaitSetImpl const& );	// prevent assignment
+
+		struct Slot
+		{
+			OpenZWave::Wait*	m_object;
+			int					m_eventFd;
+		};
+
+		Slot				m_slots[WaitSet::MaxObjects];
+		uint32				m_numObjects;
+		uint32				m_ready;		// Objects seen signalled, to be tested again
+		int					m_epollFd;
+	};
+
+} // namespace OpenZWave
+
+#endif //_WaitSetImpl_H
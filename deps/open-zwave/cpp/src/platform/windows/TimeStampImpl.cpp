@@ -112,3 +112,19 @@ int32 TimeStampImpl::operator-
 {
 	return (int32)( ( m_stamp - _other.m_stamp ) / 10000LL );
 }
+
+//-----------------------------------------------------------------------------
+//	<TimeStampImpl::GetMonotonic>
+//	Return monotonic time in microseconds
+//-----------------------------------------------------------------------------
+uint64 TimeStampImpl::GetMonotonic
+(
+)
+{
+	LARGE_INTEGER now, freq;
+
+	QueryPerformanceCounter( &now );
+	QueryPerformanceFrequency( &freq );
+	return (uint64)( ( now.QuadPart / freq.QuadPart ) * 1000000 +
+		( now.QuadPart % freq.QuadPart ) * 1000000 / freq.QuadPart );
+}
@@ -75,6 +75,11 @@ namespace OpenZWave
 		 */
 		int32 operator- ( TimeStampImpl const& _other );
 
+		/**
+		 * Monotonic time in microseconds.
+		 */
+		static uint64 GetMonotonic();
+
 	private:
 		TimeStampImpl( TimeStampImpl const& );			// prevent copy
 		TimeStampImpl& operator = ( TimeStampImpl const& );	// prevent assignment
@@ -33,6 +33,7 @@
 #include "Msg.h"
 #include "value_classes/Value.h"
 #include "platform/Log.h"
+#include "platform/TimeStamp.h"
 #include "command_classes/CommandClass.h"
 #include <ctime>
 #include "Options.h"
@@ -85,6 +86,7 @@ Value::Value
 	m_min( 0 ),
 	m_max( 0 ),
 	m_refreshTime(0),
+	m_refreshTimeStamp( 0 ),
 	m_verifyChanges( false ),
 	m_id( _homeId, _nodeId, _genre, _commandClassId, _instance, _index, _type ),
 	m_label( _label ),
@@ -97,7 +99,8 @@ Value::Value
 	m_affects(),
 	m_affectsAll( false ),
 	m_checkChange( false ),
-	m_pollIntensity( _pollIntensity )
+	m_pollIntensity( _pollIntensity ),
+	m_pollInterval( 0 )
 {
 }
 
@@ -111,6 +114,7 @@ Value::Value
 	m_min( 0 ),
 	m_max( 0 ),
 	m_refreshTime(0),
+	m_refreshTimeStamp( 0 ),
 	m_verifyChanges( false ),
 	m_readOnly( false ),
 	m_writeOnly( false ),
@@ -119,7 +123,8 @@ Value::Value
 	m_affects(),
 	m_affectsAll( false ),
 	m_checkChange( false ),
-	m_pollIntensity( 0 )
+	m_pollIntensity( 0 ),
+	m_pollInterval( 0 )
 {
 }
 
@@ -197,6 +202,11 @@ void Value::ReadXML
 		m_pollIntensity = (uint8)intVal;
 	}
 
+	if( TIXML_SUCCESS == _valueElement->QueryIntAttribute( "poll_interval", &intVal ) )
+	{
+		m_pollInterval = (uint32)intVal;
+	}
+
 	char const* affects = _valueElement->Attribute( "affects" );
 	if( affects )
 	{
@@ -305,6 +315,12 @@ void Value::WriteXML
 	snprintf( str, sizeof(str), "%d", m_pollIntensity );
 	_valueElement->SetAttribute( "poll_intensity", str );
 
+	if( m_pollInterval != 0 )
+	{
+		snprintf( str, sizeof(str), "%u", m_pollInterval );
+		_valueElement->SetAttribute( "poll_interval", str );
+	}
+
 	snprintf( str, sizeof(str), "%d", m_min );
 	_valueElement->SetAttribute( "min", str );
 
@@ -573,7 +589,7 @@ int Value::VerifyRefreshedValue
 		Value::OnValueChanged();
 		return 2;		// confirmed change of value
 	}
-	else
+	else if( Log::IsEnabled( LogLevel_Detail, m_id.GetNodeId(), m_id.GetCommandClassId() ) )
 	{
 		switch( _type )
 		{
@@ -614,10 +630,11 @@ int Value::VerifyRefreshedValue
 		}
 	}
 	m_refreshTime = time( NULL );	// update value refresh time
+	m_refreshTimeStamp = TimeStamp::GetMonotonic();
 
 	// check whether changes in this value should be verified (since some devices will report values that always
 	// change, where confirming changes is difficult or impossible)
-	Log::Write( LogLevel_Detail, m_id.GetNodeId(), "Changes to this value are %sverified", m_verifyChanges ? "" : "not " );
+	OZW_LOG_CC( LogLevel_Detail, m_id.GetNodeId(), m_id.GetCommandClassId(), "Changes to this value are %sverified", m_verifyChanges ? "" : "not " );
 
 	if( !m_verifyChanges )
 	{
@@ -71,6 +71,13 @@ namespace OpenZWave
 		uint8 const& GetPollIntensity()const{ return m_pollIntensity; }
 		void SetPollIntensity( uint8 const& _intensity ){ m_pollIntensity = _intensity; }
 
+		/**
+		 * \brief How often the value is polled, in milliseconds.  Zero means that it is
+		 * worked out from the poll intensity and the driver's poll interval.
+		 */
+		uint32 GetPollInterval()const{ return m_pollInterval; }
+		void SetPollInterval( uint32 const _interval ){ m_pollInterval = _interval; }
+
 		int32 GetMin()const{ return m_min; }
 		int32 GetMax()const{ return m_max; }
 
@@ -101,6 +108,7 @@ namespace OpenZWave
 		int32		m_max;
 
 		time_t		m_refreshTime;			// time_t identifying when this value was last refreshed
+		uint64		m_refreshTimeStamp;		// Monotonic time in us when this value was last refreshed, or 0
 		bool		m_verifyChanges;		// if true, apparent changes are verified; otherwise, they're not
 
 	private:
@@ -116,6 +124,7 @@ namespace OpenZWave
 		bool		m_affectsAll;
 		bool		m_checkChange;
 		uint8		m_pollIntensity;
+		uint32		m_pollInterval;
 	};
 
 } // namespace OpenZWave
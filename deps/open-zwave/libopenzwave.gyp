@@ -87,6 +87,7 @@
         "cpp/src/platform/Thread.cpp",
         "cpp/src/platform/TimeStamp.cpp",
         "cpp/src/platform/Wait.cpp",
+        "cpp/src/platform/WaitSet.cpp",
         "cpp/src/platform/unix/EventImpl.cpp",
         "cpp/src/platform/unix/FileOpsImpl.cpp",
         "cpp/src/platform/unix/LogImpl.cpp",
@@ -95,6 +96,7 @@
         "cpp/src/platform/unix/ThreadImpl.cpp",
         "cpp/src/platform/unix/TimeStampImpl.cpp",
         "cpp/src/platform/unix/WaitImpl.cpp",
+        "cpp/src/platform/unix/WaitSetImpl.cpp",
         "cpp/src/Driver.cpp",
         "cpp/src/Group.cpp",
         "cpp/src/Manager.cpp",
@@ -16,6 +16,7 @@
 
 var addon = require(__dirname + '/../build/Release/openzwave.node').Emitter;
 var events = require('events');
+var os = require('os');
 
 /*
  * Extend prototype.
@@ -35,7 +36,16 @@ var _options = {
 	saveconfig: false,
 	driverattempts: 3,
 	pollinterval: 500,
-	suppressrefresh: true,
+	retrytimeout: 40000,
+	minretrytimeout: 2000,
+	freshpollpercent: 50,
+	batchevents: false,
+	valuecatalog: false,
+	queuesize: 4096,
+	highwater: 3072,
+	binaryevents: false,
+	recordbuffer: 1024,
+	writetimeout: 10000,
 }
 var ZWave = function(path, options) {
 	options = options || {};
@@ -45,14 +55,40 @@ var ZWave = function(path, options) {
 	options.saveconfig = options.saveconfig || _options.saveconfig;
 	options.driverattempts = options.driverattempts || _options.driverattempts;
 	options.pollinterval = options.pollinterval || _options.pollinterval;
-	options.suppressrefresh = options.suppressrefresh || _options.suppressrefresh;
+	options.retrytimeout = options.retrytimeout || _options.retrytimeout;
+	options.minretrytimeout = (options.minretrytimeout === undefined) ?
+	    _options.minretrytimeout : options.minretrytimeout;
+	options.freshpollpercent = (options.freshpollpercent === undefined) ?
+	    _options.freshpollpercent : options.freshpollpercent;
+	options.batchevents = options.batchevents || _options.batchevents;
+	options.valuecatalog = options.valuecatalog || _options.valuecatalog;
+	options.queuesize = options.queuesize || _options.queuesize;
+	options.highwater = (options.highwater === undefined) ?
+	    _options.highwater : options.highwater;
+	options.binaryevents = options.binaryevents || _options.binaryevents;
+	options.recordbuffer = options.recordbuffer || _options.recordbuffer;
+	options.writetimeout = (options.writetimeout === undefined) ?
+	    _options.writetimeout : options.writetimeout;
 	this.path = path;
 	this.addon = new addon(options);
 	this.addon.emit = this.emit.bind(this);
+	this.records = this.addon.getRecordBuffer();
+}
+
+/*
+ * Forward native methods to this instance's addon object, which holds the
+ * state for our controller.
+ */
+function forward(target, source) {
+	Object.keys(source.prototype).forEach(function(k) {
+		target.prototype[k] = function() {
+			return this.addon[k].apply(this.addon, arguments);
+		}
+	});
 }
 
 inherits(ZWave, events.EventEmitter);
-inherits(ZWave, addon);
+forward(ZWave, addon);
 
 ZWave.prototype.connect = function() {
 	this.addon.connect(this.path);
@@ -62,4 +98,36 @@ ZWave.prototype.disconnect = function() {
 	this.addon.disconnect(this.path);
 }
 
+ZWave.prototype.reconnect = function() {
+	return this.addon.reconnect();
+}
+
+ZWave.prototype.getQueueStats = function() {
+	return this.addon.getQueueStats();
+}
+
+/*
+ * Decode a record from the binary event stream (see the 'records' event),
+ * optionally reusing an existing object to avoid allocation.
+ */
+var RECORD_SIZE = 32;
+var LE = (os.endianness() === 'LE');
+
+ZWave.prototype.readRecord = function(idx, rec) {
+	var buf = this.records;
+	var off = idx * RECORD_SIZE;
+	rec = rec || {};
+	rec.homeid = LE ? buf.readUInt32LE(off) : buf.readUInt32BE(off);
+	rec.nodeid = buf[off + 4];
+	rec.comclass = buf[off + 5];
+	rec.instance = buf[off + 6];
+	rec.index = buf[off + 7];
+	rec.type = buf[off + 8];
+	rec.value = LE ? buf.readDoubleLE(off + 16) : buf.readDoubleBE(off + 16);
+	rec.timestamp = LE ? buf.readDoubleLE(off + 24) : buf.readDoubleBE(off + 24);
+	return rec;
+}
+
+ZWave.RECORD_SIZE = RECORD_SIZE;
+
 module.exports = ZWave;
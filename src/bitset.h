@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2013 Jonathan Perkin <jonathan@perkin.org.uk>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef BITSET_H
+#define BITSET_H
+
+#include <stdint.h>
+
+/*
+ * Fixed-size bitset which may be tested from one thread while another
+ * replaces it.  Each word is loaded and stored atomically, so a reader may
+ * briefly see a mix of the old and new sets, but never a torn word.
+ * Everything is set by default.
+ */
+template <uint32_t N>
+class AtomicBitset {
+public:
+	AtomicBitset() { fill(true); }
+
+	void fill(bool on)
+	{
+		for (uint32_t i = 0; i < WORDS; i++)
+			words[i] = on ? ~0U : 0;
+	}
+
+	/*
+	 * Not atomic, for building up a set before assign().
+	 */
+	void set(uint32_t i)
+	{
+		if (i < N)
+			words[i >> 5] |= 1U << (i & 31);
+	}
+
+	/*
+	 * Atomically set or clear a single bit in place.
+	 */
+	void store(uint32_t i, bool on)
+	{
+		if (i >= N)
+			return;
+		if (on)
+			__atomic_or_fetch(&words[i >> 5], 1U << (i & 31), __ATOMIC_RELAXED);
+		else
+			__atomic_and_fetch(&words[i >> 5], ~(1U << (i & 31)), __ATOMIC_RELAXED);
+	}
+
+	bool test(uint32_t i) const
+	{
+		return i < N &&
+		    (__atomic_load_n(&words[i >> 5], __ATOMIC_RELAXED) & (1U << (i & 31)));
+	}
+
+	void assign(AtomicBitset const &other)
+	{
+		for (uint32_t i = 0; i < WORDS; i++)
+			__atomic_store_n(&words[i], other.words[i], __ATOMIC_RELAXED);
+	}
+
+private:
+	enum { WORDS = (N + 31) / 32 };
+
+	uint32_t			words[WORDS];
+};
+
+#endif
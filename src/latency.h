@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2013 Jonathan Perkin <jonathan@perkin.org.uk>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+
+/*
+ * Log-linear latency histogram in microseconds.  Values below 8us have a
+ * bucket each, above that every power of two is split into four, so any
+ * percentile is within 25% of the true value.  Recording is a handful of
+ * instructions and a relaxed atomic add, cheap enough to always be on.
+ * Values over 2^35us (about 9.5 hours) are clamped into the last bucket.
+ *
+ * Each histogram has a single writer, but is read and reset from the v8
+ * thread, hence the atomics.
+ */
+class LatencyHistogram {
+public:
+	enum { LINEAR = 8, SUBBITS = 2, MAXBITS = 35,
+	       BUCKETS = LINEAR + (MAXBITS - 2) * (1 << SUBBITS) };
+
+	LatencyHistogram() { reset(); }
+
+	void record(uint64_t us)
+	{
+		uint64_t max = __atomic_load_n(&maxval, __ATOMIC_RELAXED);
+
+		__atomic_fetch_add(&counts[bucket(us)], 1, __ATOMIC_RELAXED);
+		__atomic_fetch_add(&total, 1, __ATOMIC_RELAXED);
+		while (us > max && !__atomic_compare_exchange_n(&maxval, &max,
+		    us, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+			;
+	}
+
+	void reset()
+	{
+		for (uint32_t i = 0; i < BUCKETS; i++)
+			__atomic_store_n(&counts[i], 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&total, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&maxval, 0, __ATOMIC_RELAXED);
+	}
+
+	/*
+	 * Add another histogram into this one, used to build the totals
+	 * across notification types.
+	 */
+	void merge(LatencyHistogram const &other)
+	{
+		uint64_t omax = __atomic_load_n(&other.maxval, __ATOMIC_RELAXED);
+
+		for (uint32_t i = 0; i < BUCKETS; i++)
+			counts[i] += __atomic_load_n(&other.counts[i], __ATOMIC_RELAXED);
+		total += __atomic_load_n(&other.total, __ATOMIC_RELAXED);
+		if (omax > maxval)
+			maxval = omax;
+	}
+
+	uint64_t count() const { return __atomic_load_n(&total, __ATOMIC_RELAXED); }
+	uint64_t max() const { return __atomic_load_n(&maxval, __ATOMIC_RELAXED); }
+
+	/*
+	 * Return the p'th percentile (0 < p <= 100), as the midpoint of the
+	 * bucket it falls in, but never more than the largest value seen.
+	 */
+	uint64_t percentile(double p) const
+	{
+		uint64_t n = count(), seen = 0, rank, mid;
+
+		if (n == 0)
+			return 0;
+
+		rank = (uint64_t)(n * p / 100.0 + 0.5);
+		if (rank < 1)
+			rank = 1;
+
+		for (uint32_t i = 0; i < BUCKETS; i++) {
+			seen += __atomic_load_n(&counts[i], __ATOMIC_RELAXED);
+			if (seen >= rank) {
+				mid = lower(i) + width(i) / 2;
+				return (mid < max()) ? mid : max();
+			}
+		}
+
+		return max();
+	}
+
+private:
+	static uint32_t bucket(uint64_t us)
+	{
+		uint32_t msb;
+
+		if (us < LINEAR)
+			return (uint32_t)us;
+
+		msb = 63 - __builtin_clzll(us);
+		if (msb >= MAXBITS)
+			return BUCKETS - 1;
+
+		return LINEAR + ((msb - 3) << SUBBITS) +
+		    (uint32_t)((us >> (msb - SUBBITS)) & ((1 << SUBBITS) - 1));
+	}
+
+	static uint64_t lower(uint32_t i)
+	{
+		uint32_t msb, sub;
+
+		if (i < LINEAR)
+			return i;
+
+		msb = ((i - LINEAR) >> SUBBITS) + 3;
+		sub = (i - LINEAR) & ((1 << SUBBITS) - 1);
+
+		return (uint64_t)((1 << SUBBITS) + sub) << (msb - SUBBITS);
+	}
+
+	static uint64_t width(uint32_t i)
+	{
+		if (i < LINEAR)
+			return 1;
+
+		return (uint64_t)1 << (((i - LINEAR) >> SUBBITS) + 3 - SUBBITS);
+	}
+
+	uint32_t			counts[BUCKETS];
+	uint64_t			total;
+	uint64_t			maxval;
+};
+
+#endif
@@ -0,0 +1,400 @@
+/*
+ * Copyright (c) 2013 Jonathan Perkin <jonathan@perkin.org.uk>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef NOTIFRING_H
+#define NOTIFRING_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deque>
+
+#include "registry.h"
+
+/*
+ * A single notification, copied out of OpenZWave in the watcher callback.
+ * Records are fixed-size and live in the ring, so they must stay POD.  The
+ * ValueID is stored as its 64-bit id and rebuilt together with homeid.
+ */
+typedef struct {
+	uint32_t			type;
+	uint32_t			homeid;
+	uint8_t				nodeid;
+	uint8_t				groupidx;
+	uint8_t				event;
+	uint8_t				buttonid;
+	uint8_t				sceneid;
+	uint8_t				notification;
+	uint64_t			valueid;
+	uint64_t			timestamp;	/* ms since the epoch */
+	/*
+	 * Monotonic times in us, for latency statistics: when the frame
+	 * which caused the notification was received (or when OpenZWave
+	 * queued it, if it was not caused by a frame), and when our
+	 * callback saw it.
+	 */
+	uint64_t			t_origin;
+	uint64_t			t_cb;
+	/*
+	 * For ValueAdded and ValueChanged, a snapshot of the value and its
+	 * metadata taken on the OpenZWave thread.  Strings are truncated to
+	 * fit.  List values carry their selection in str and the value of
+	 * the selected item (not its position in the list) in val.i.
+	 */
+	bool				read_only;
+	/*
+	 * A ValueAdded during a node's initial queries in catalog mode,
+	 * which carries no snapshot and is not emitted.
+	 */
+	bool				deferred;
+	bool				write_only;
+	int32_t				min;
+	int32_t				max;
+	union {
+		bool			b;
+		uint8_t			byte;
+		float			dec;
+		int32_t			i;
+		int16_t			s;
+	} val;
+	char				label[64];
+	char				units[32];
+	char				str[128];
+} NotifInfo;
+
+/*
+ * Single-producer/single-consumer ring of notification records between the
+ * OpenZWave watcher callback and the v8 async handler.
+ *
+ * OpenZWave serialises all watcher callbacks under the Manager notification
+ * mutex, so there is only ever one producer at a time, and the only consumer
+ * is the libuv thread.  Neither side takes a lock, and all records are
+ * allocated up front by init().  When the ring is full the notification is
+ * dropped and counted in overflows.
+ */
+class NotifRing {
+public:
+	NotifRing(): ring(NULL), mask(0), head(0), tail(0), overflows(0) {}
+	~NotifRing() { free(ring); }
+
+	/*
+	 * Allocate the ring, rounding capacity up to a power of two.
+	 */
+	bool init(uint32_t capacity)
+	{
+		uint32_t size = 1;
+
+		while (size < capacity)
+			size <<= 1;
+
+		if ((ring = (NotifInfo *)calloc(size, sizeof(NotifInfo))) == NULL)
+			return false;
+
+		mask = size - 1;
+		head = tail = overflows = 0;
+
+		return true;
+	}
+
+	bool initialized() const { return ring != NULL; }
+	uint32_t capacity() const { return mask + 1; }
+	uint32_t depth() const
+	{
+		return __atomic_load_n(&tail, __ATOMIC_ACQUIRE) -
+		       __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+	}
+	uint32_t overflowed() const
+	{
+		return __atomic_load_n(&overflows, __ATOMIC_RELAXED);
+	}
+
+	/*
+	 * Producer: return the next free record, or NULL if the ring is full.
+	 * The record is not visible to the consumer until commit().
+	 */
+	NotifInfo *reserve()
+	{
+		uint32_t t = __atomic_load_n(&tail, __ATOMIC_RELAXED);
+
+		if (t - __atomic_load_n(&head, __ATOMIC_ACQUIRE) > mask) {
+			__atomic_add_fetch(&overflows, 1, __ATOMIC_RELAXED);
+			return NULL;
+		}
+
+		return &ring[t & mask];
+	}
+	void commit()
+	{
+		__atomic_store_n(&tail, tail + 1, __ATOMIC_RELEASE);
+	}
+
+	/*
+	 * Consumer: return the oldest record, or NULL if the ring is empty.
+	 * The record remains valid until pop().
+	 */
+	NotifInfo *front()
+	{
+		uint32_t h = __atomic_load_n(&head, __ATOMIC_RELAXED);
+
+		if (h == __atomic_load_n(&tail, __ATOMIC_ACQUIRE))
+			return NULL;
+
+		return &ring[h & mask];
+	}
+	void pop()
+	{
+		__atomic_store_n(&head, head + 1, __ATOMIC_RELEASE);
+	}
+
+private:
+	NotifRing(const NotifRing&);
+	NotifRing& operator=(const NotifRing&);
+
+	/*
+	 * head is only written by the consumer, tail and overflows only by
+	 * the producer; keep them on separate cache lines.
+	 */
+	NotifInfo			*ring;
+	uint32_t			mask;
+	char				pad0[64];
+	uint32_t			head;
+	char				pad1[64];
+	uint32_t			tail;
+	uint32_t			overflows;
+};
+
+/*
+ * The notification queue proper.  Notifications normally go straight into
+ * the ring, but once it reaches the high-water mark they are spilled into a
+ * backlog protected by a mutex, where:
+ *
+ *   - ValueChanged notifications replace any pending change for the same
+ *     value, so a storm from one device only ever holds one entry per value.
+ *     The entry keeps the times of the first change, so that the age of the
+ *     backlog still shows how far behind the consumer is.
+ *   - ValueRefreshed notifications are absorbed by any pending change or
+ *     refresh for the same value, which takes on the refreshed value, and
+ *     are replaced by a later change.  They are never dropped outright, as
+ *     they confirm writes.
+ *   - Droppable notifications, which carry no state we need to keep, are
+ *     discarded and counted in overflows once the backlog is as large as
+ *     the ring.
+ *   - Everything else, such as node and value topology, is always kept.
+ *     Nothing is ever coalesced across a topology change to its value.
+ *
+ * Once anything has been spilled, all notifications go to the backlog until
+ * the consumer has taken it, so that ordering is preserved.  The consumer
+ * drains the ring before taking the backlog, and delivers a taken backlog
+ * before looking at the ring again.
+ */
+class NotifQueue {
+public:
+	/*
+	 * How a notification is treated in the backlog.  Value notifications
+	 * also pass their registry key.  An ABSORB notification is discarded
+	 * if one for the same key is already pending, otherwise it is kept
+	 * and may be replaced by a later COALESCE.  A BARRIER, such as a node
+	 * being removed, stops any earlier change from being coalesced with a
+	 * later one.
+	 */
+	enum Policy { KEEP, DROPPABLE, COALESCE, ABSORB, BARRIER };
+
+	NotifQueue(): highwater(0), spilling(false), spilled(0), coalesced(0),
+	    dropped(0), taken_pos(0)
+	{
+		pthread_mutex_init(&lock, NULL);
+	}
+	~NotifQueue() { pthread_mutex_destroy(&lock); }
+
+	bool init(uint32_t capacity, uint32_t hwm)
+	{
+		if (!ring.init(capacity))
+			return false;
+
+		highwater = (hwm == 0 || hwm > ring.capacity()) ? ring.capacity() : hwm;
+
+		return true;
+	}
+
+	bool initialized() const { return ring.initialized(); }
+	uint32_t capacity() const { return ring.capacity(); }
+	uint32_t highwatermark() const { return highwater; }
+	uint32_t depth() const
+	{
+		return ring.depth() + __atomic_load_n(&spilled, __ATOMIC_ACQUIRE) +
+		    (taken.size() - taken_pos);
+	}
+	uint32_t overflowed() const
+	{
+		return __atomic_load_n(&dropped, __ATOMIC_RELAXED);
+	}
+	uint32_t coalesced_count() const
+	{
+		return __atomic_load_n(&coalesced, __ATOMIC_RELAXED);
+	}
+
+	/*
+	 * Producer: return a record to fill in, either the next slot in the
+	 * ring or, once above the high-water mark, scratch space which is
+	 * copied into the backlog by commit().
+	 */
+	NotifInfo *reserve()
+	{
+		spilling = __atomic_load_n(&spilled, __ATOMIC_ACQUIRE) > 0 ||
+		    ring.depth() >= highwater;
+
+		return spilling ? &scratch : ring.reserve();
+	}
+	void commit(Policy policy, uint32_t key)
+	{
+		uint32_t *pos;
+
+		if (!spilling) {
+			ring.commit();
+			return;
+		}
+
+		pthread_mutex_lock(&lock);
+		if ((policy == COALESCE || policy == ABSORB) &&
+		    (pos = index.find(key)) != NULL) {
+			if (policy == COALESCE) {
+				/*
+				 * The entry keeps its place in the queue, and
+				 * so its times, for the age and latency of
+				 * what is waiting.
+				 */
+				NotifInfo &pending = backlog[*pos];
+				uint64_t timestamp = pending.timestamp;
+				uint64_t t_origin = pending.t_origin;
+				uint64_t t_cb = pending.t_cb;
+
+				pending = scratch;
+				pending.timestamp = timestamp;
+				pending.t_origin = t_origin;
+				pending.t_cb = t_cb;
+			} else {
+				/*
+				 * The pending entry takes on the refreshed
+				 * value, so that it can still confirm a
+				 * write of that value.
+				 */
+				backlog[*pos].val = scratch.val;
+				memcpy(backlog[*pos].str, scratch.str,
+				    sizeof(scratch.str));
+			}
+			__atomic_add_fetch(&coalesced, 1, __ATOMIC_RELAXED);
+		} else if (policy == DROPPABLE && backlog.size() >= ring.capacity()) {
+			__atomic_add_fetch(&dropped, 1, __ATOMIC_RELAXED);
+		} else {
+			if (policy == COALESCE || policy == ABSORB)
+				*index.insert(key) = backlog.size();
+			else if (policy == BARRIER)
+				index.clear();
+			else if (key)
+				index.erase(key);
+			backlog.push_back(scratch);
+			__atomic_store_n(&spilled, backlog.size(), __ATOMIC_RELEASE);
+		}
+		pthread_mutex_unlock(&lock);
+	}
+
+	/*
+	 * Consumer: return the oldest record, or NULL if there is nothing
+	 * pending.  The record remains valid until pop().
+	 */
+	NotifInfo *front()
+	{
+		NotifInfo *notif;
+
+		if (taken_pos < taken.size())
+			return &taken[taken_pos];
+		if ((notif = ring.front()) != NULL)
+			return notif;
+		if (__atomic_load_n(&spilled, __ATOMIC_ACQUIRE) == 0)
+			return NULL;
+
+		taken.clear();
+		taken_pos = 0;
+		pthread_mutex_lock(&lock);
+		taken.swap(backlog);
+		index.clear();
+		__atomic_store_n(&spilled, 0, __ATOMIC_RELEASE);
+		pthread_mutex_unlock(&lock);
+
+		return taken.empty() ? NULL : &taken[0];
+	}
+	void pop()
+	{
+		if (taken_pos < taken.size())
+			taken_pos++;
+		else
+			ring.pop();
+	}
+
+	/*
+	 * Consumer: timestamp of the oldest pending record, or 0.
+	 */
+	uint64_t oldest()
+	{
+		NotifInfo *notif;
+		uint64_t ts = 0;
+
+		if (taken_pos < taken.size())
+			return taken[taken_pos].timestamp;
+		if ((notif = ring.front()) != NULL)
+			return notif->timestamp;
+
+		pthread_mutex_lock(&lock);
+		if (!backlog.empty())
+			ts = backlog.front().timestamp;
+		pthread_mutex_unlock(&lock);
+
+		return ts;
+	}
+
+private:
+	NotifQueue(const NotifQueue&);
+	NotifQueue& operator=(const NotifQueue&);
+
+	NotifRing			ring;
+	uint32_t			highwater;
+
+	/*
+	 * Producer only.
+	 */
+	bool				spilling;
+	NotifInfo			scratch;
+
+	/*
+	 * Protected by lock, with spilled mirroring the backlog size so that
+	 * neither side needs the lock while the backlog is empty.
+	 */
+	pthread_mutex_t			lock;
+	std::deque<NotifInfo>		backlog;
+	FlatMap<uint32_t>		index;
+	uint32_t			spilled;
+	uint32_t			coalesced;
+	uint32_t			dropped;
+
+	/*
+	 * Consumer only, the backlog most recently taken.
+	 */
+	std::deque<NotifInfo>		taken;
+	size_t				taken_pos;
+};
+
+#endif
@@ -14,12 +14,15 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <math.h>
+#include <sys/time.h>
 #include <unistd.h>
 #include <pthread.h>
 #include <list>
-#include <queue>
+#include <vector>
 
 #include <node.h>
+#include <node_buffer.h>
 #include <v8.h>
 
 #include "Manager.h"
@@ -27,17 +30,152 @@
 #include "Notification.h"
 #include "Options.h"
 #include "Value.h"
+#include "platform/TimeStamp.h"
+
+#include "bitset.h"
+#include "latency.h"
+#include "notifring.h"
+#include "registry.h"
 
 using namespace v8;
 using namespace node;
 
 namespace {
 
+typedef struct {
+	uint32_t			homeid;
+	uint8_t				nodeid;
+	bool				polled;
+} NodeInfo;
+
+/*
+ * The label, units and limits of a value do not change, so keep a single
+ * copy of each rather than creating new strings for every event.  Keyed the
+ * same as the value registry.
+ */
+typedef struct {
+	Persistent<String>		label;
+	Persistent<String>		units;
+	bool				read_only;
+	bool				write_only;
+	int32_t				min;
+	int32_t				max;
+} ValueMeta;
+
+/*
+ * Outstanding writes from setValues().  A write completes when the device
+ * reports the value it was set to (ValueChanged or ValueRefreshed), and
+ * fails if the node is reported dead or no such report is heard within
+ * write_timeout ms.  The value written is kept in num, or str for strings.
+ * zwrite_keys counts pending writes per value so that the common case of
+ * no pending write for a reported value does not walk the list, and
+ * zwrite_nodes per node.  The OpenZWave callback queues changes on nodes in
+ * zwriting whether or not they have been subscribed to, so that writes to
+ * filtered values still complete.
+ */
+typedef struct {
+	Persistent<Function>		cb;
+	Persistent<Array>		results;
+	uint32_t			remaining;
+	uint32_t			failed;
+} WriteBatch;
+
+typedef struct {
+	WriteBatch			*batch;
+	uint32_t			slot;
+	uint32_t			key;
+	uint64_t			started;
+	double				num;
+	std::string			str;
+} PendingWrite;
+
+/*
+ * Binary record stream.  When enabled, ValueChanged notifications are
+ * written as fixed-size records into a Buffer shared with JavaScript, and
+ * only the position of new records is emitted.  Each record is laid out in
+ * host byte order as:
+ *
+ *	 0	uint32	homeid
+ *	 4	uint8	nodeid
+ *	 5	uint8	command class
+ *	 6	uint8	instance
+ *	 7	uint8	index
+ *	 8	uint8	value type
+ *	 9-15		reserved
+ *	16	double	value (NaN for strings, value of the selected item for lists)
+ *	24	double	timestamp, milliseconds since the epoch
+ */
+#define RECORD_SIZE	32
+
+/*
+ * Stages of notification delivery which we keep latency statistics for:
+ *
+ *	read		frame received by the serial thread to frame read and
+ *			verified by the driver
+ *	dispatch	frame verified to notification queued by OpenZWave
+ *	notify		queued by OpenZWave to seen by our callback
+ *	deliver		seen by our callback to emitted to JavaScript
+ *	total		frame received (or queued, if there was no frame) to
+ *			emitted to JavaScript
+ */
+enum {
+	LATENCY_READ,
+	LATENCY_DISPATCH,
+	LATENCY_NOTIFY,
+	LATENCY_DELIVER,
+	LATENCY_TOTAL,
+	LATENCY_STAGES
+};
+
+/*
+ * Options which are passed to OpenZWave.  These are process-wide, so they
+ * are taken from whichever instance connects first.
+ */
+typedef struct {
+	std::string			confpath;
+	bool				consoleoutput;
+	bool				logging;
+	bool				saveconfig;
+	int32_t				driverattempts;
+	int32_t				pollinterval;
+	int32_t				retrytimeout;
+	int32_t				minretrytimeout;
+	int32_t				freshpollpercent;
+} DriverOptions;
+
+/*
+ * State belonging to the environment the addon was loaded into, created by
+ * init() and shared by all instances created there: the event loop, and
+ * the property names, strings and template used to build value objects.
+ * These are created once, so that value events reuse the same handles and
+ * every value object shares the same hidden class.
+ */
+typedef struct {
+	uv_loop_t			*loop;
+	Persistent<String>		sym_emit, sym_type, sym_genre, sym_instance,
+	    sym_index, sym_label, sym_units, sym_read_only, sym_write_only,
+	    sym_min, sym_max, sym_value, sym_nodeid, sym_comclass, sym_error,
+	    sym_latency;
+	Persistent<String>		ev_value_added, ev_value_changed;
+	Persistent<String>		type_names[OpenZWave::ValueID::ValueType_Max + 1];
+	Persistent<String>		genre_names[OpenZWave::ValueID::ValueGenre_Count];
+	Persistent<ObjectTemplate>	value_tmpl;
+} AddonData;
+
+/*
+ * Each instance drives a single controller.  All instances share the one
+ * OpenZWave Manager, each adding its own driver and watcher, and the watcher
+ * only accepts notifications for its own network.
+ */
 struct OZW: ObjectWrap {
+	OZW(AddonData *data);
+
 	static Handle<Value> New(const Arguments& args);
 	static Handle<Value> Connect(const Arguments& args);
 	static Handle<Value> Disconnect(const Arguments& args);
+	static Handle<Value> Reconnect(const Arguments& args);
 	static Handle<Value> SetValue(const Arguments& args);
+	static Handle<Value> SetValues(const Arguments& args);
 	static Handle<Value> SetLevel(const Arguments& args);
 	static Handle<Value> SetLocation(const Arguments& args);
 	static Handle<Value> SetName(const Arguments& args);
@@ -47,60 +185,294 @@ struct OZW: ObjectWrap {
 	static Handle<Value> DisablePoll(const Arguments& args);
 	static Handle<Value> HardReset(const Arguments& args);
 	static Handle<Value> SoftReset(const Arguments& args);
+	static Handle<Value> GetQueueStats(const Arguments& args);
+	static Handle<Value> GetLatencyStats(const Arguments& args);
+	static Handle<Value> GetDriverStats(const Arguments& args);
+	static Handle<Value> GetRecordBuffer(const Arguments& args);
+	static Handle<Value> GetValueMeta(const Arguments& args);
+	static Handle<Value> GetNodes(const Arguments& args);
+	static Handle<Value> GetValues(const Arguments& args);
+	static Handle<Value> Subscribe(const Arguments& args);
+
+	AddonData			*data;
+	Persistent<Object>		context_obj;
+	uv_async_t			async;
+	DriverOptions			options;
+	std::string			path;
+	bool				connected;
+
+	/*
+	 * Home id of our network, as seen by the JavaScript side.
+	 */
+	uint32_t			homeid;
+
+	/*
+	 * Only used by the OpenZWave callback.  Until our driver is ready
+	 * we do not know which home id is ours.
+	 */
+	bool				bound;
+	uint32_t			bound_homeid;
+
+	/*
+	 * Message passing queue between OpenZWave callback and v8 async
+	 * handler.
+	 */
+	NotifQueue			zqueue;
+
+	/*
+	 * Notifications which JavaScript has subscribed to, tested by the
+	 * OpenZWave callback before anything is queued.
+	 */
+	AtomicBitset<256>		sub_nodes;
+	AtomicBitset<256>		sub_classes;
+	AtomicBitset<32>		sub_types;
+
+	/*
+	 * In catalog mode the values of a node are delivered with its
+	 * "node ready" event rather than as individual "value added"
+	 * events.  catalog_ready tracks which nodes have finished their
+	 * initial queries, and is only accessed by the OpenZWave callback.
+	 */
+	bool				value_catalog;
+	bool				catalog_ready[256];
+
+	/*
+	 * Latency of each stage of delivery, per notification type.  The
+	 * first three stages are recorded by the OpenZWave callback, the
+	 * rest by the async handler.
+	 */
+	LatencyHistogram		latency[32][LATENCY_STAGES];
+
+	/*
+	 * Node state, indexed by node id, the registry of all known values
+	 * and their metadata.  All are only accessed from the v8 thread.
+	 */
+	NodeInfo			*znodes[256];
+	ValueRegistry			zvalues;
+	FlatMap<ValueMeta>		zmeta;
+
+	/*
+	 * Deliver all notifications from a single wakeup as one "events"
+	 * emit rather than one emit per notification.
+	 */
+	bool				batch_events;
+
+	bool				binary_events;
+	Persistent<Object>		record_buf;
+	char				*record_data;
+	uint32_t			record_cap;
+	uint32_t			record_next;
+	uint32_t			record_pending;
+
+	std::list<PendingWrite>		zwrites;
+	FlatMap<uint32_t>		zwrite_keys;
+	uint32_t			zwrite_nodes[256];
+	AtomicBitset<256>		zwriting;
+	std::list<WriteBatch *>		zfinished;
+	uv_timer_t			write_timer;
+	uv_timer_t			finish_timer;
+	uint32_t			write_timeout;
 };
 
-Persistent<Object> context_obj;
+/*
+ * The Manager is shared by every connected instance in the process, and
+ * destroyed again once the last one disconnects.  This is the only state
+ * which is not per-environment.
+ */
+static pthread_mutex_t manager_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t manager_refs;
 
-uv_async_t async;
+static void async_cb_handler(uv_async_t *handle, int status);
 
-typedef struct {
-	uint32_t			type;
-	uint32_t			homeid;
-	uint8_t				nodeid;
-	uint8_t				groupidx;
-	uint8_t				event;
-	uint8_t				buttonid;
-	uint8_t				sceneid;
-	uint8_t				notification;
-	std::list<OpenZWave::ValueID>	values;
-} NotifInfo;
+OZW::OZW(AddonData *data): data(data), connected(false), homeid(0),
+    bound(false), bound_homeid(0), value_catalog(false), batch_events(false), binary_events(false), record_data(NULL),
+    record_cap(0), record_next(0), record_pending(0), write_timeout(0)
+{
+	memset(znodes, 0, sizeof(znodes));
+	memset(catalog_ready, 0, sizeof(catalog_ready));
+	memset(zwrite_nodes, 0, sizeof(zwrite_nodes));
+	zwriting.fill(false);
 
-typedef struct {
-	uint32_t			homeid;
-	uint8_t				nodeid;
-	bool				polled;
-	std::list<OpenZWave::ValueID>	values;
-} NodeInfo;
+	/*
+	 * The handles are only referenced while connected, so that an idle
+	 * instance does not keep the event loop alive.
+	 */
+	uv_async_init(data->loop, &async, async_cb_handler);
+	async.data = this;
+	uv_unref((uv_handle_t *)&async);
+	uv_timer_init(data->loop, &write_timer);
+	write_timer.data = this;
+	uv_timer_init(data->loop, &finish_timer);
+	finish_timer.data = this;
+}
 
 /*
- * Message passing queue between OpenZWave callback and v8 async handler.
+ * Copy a value and its metadata into a notification record.  This runs on
+ * the OpenZWave thread, so that the v8 thread never has to go through the
+ * Manager and contend with the driver for the node lock.
  */
-static pthread_mutex_t zqueue_mutex = PTHREAD_MUTEX_INITIALIZER;
-static std::queue<NotifInfo *> zqueue;
+static void snapshot_value(NotifInfo *notif, OpenZWave::ValueID const &value)
+{
+	OpenZWave::Manager *mgr = OpenZWave::Manager::Get();
+	std::string str;
+
+	snprintf(notif->label, sizeof(notif->label), "%s",
+		 mgr->GetValueLabel(value).c_str());
+	snprintf(notif->units, sizeof(notif->units), "%s",
+		 mgr->GetValueUnits(value).c_str());
+	notif->read_only = mgr->IsValueReadOnly(value);
+	notif->write_only = mgr->IsValueWriteOnly(value);
+	notif->min = mgr->GetValueMin(value);
+	notif->max = mgr->GetValueMax(value);
+	notif->str[0] = '\0';
+
+	switch (value.GetType()) {
+	case OpenZWave::ValueID::ValueType_Bool:
+		mgr->GetValueAsBool(value, &notif->val.b);
+		break;
+	case OpenZWave::ValueID::ValueType_Byte:
+		mgr->GetValueAsByte(value, &notif->val.byte);
+		break;
+	case OpenZWave::ValueID::ValueType_Decimal:
+		mgr->GetValueAsFloat(value, &notif->val.dec);
+		break;
+	case OpenZWave::ValueID::ValueType_Int:
+		mgr->GetValueAsInt(value, &notif->val.i);
+		break;
+	case OpenZWave::ValueID::ValueType_List:
+		mgr->GetValueListSelection(value, &notif->val.i);
+		mgr->GetValueListSelection(value, &str);
+		snprintf(notif->str, sizeof(notif->str), "%s", str.c_str());
+		break;
+	case OpenZWave::ValueID::ValueType_Short:
+		mgr->GetValueAsShort(value, &notif->val.s);
+		break;
+	case OpenZWave::ValueID::ValueType_String:
+		mgr->GetValueAsString(value, &str);
+		snprintf(notif->str, sizeof(notif->str), "%s", str.c_str());
+		break;
+	default:
+		break;
+	}
+}
 
 /*
- * Node state.
+ * Every watcher sees the notifications for all drivers.  Until our driver
+ * has started we claim the DriverReady or DriverFailed for our controller
+ * path, after that we only accept our own home id until that driver is
+ * removed.  hardReset() does that, and brings the controller back up with a
+ * new home id, whose DriverReady we then claim.  OpenZWave serialises
+ * watcher callbacks, so the bound state needs no locking.
  */
-static pthread_mutex_t znodes_mutex = PTHREAD_MUTEX_INITIALIZER;
-static std::list<NodeInfo *> znodes;
+static bool accept_notification(OZW *self, OpenZWave::Notification const *cb)
+{
+	if (self->bound) {
+		if (cb->GetHomeId() != self->bound_homeid)
+			return false;
+		if (cb->GetType() == OpenZWave::Notification::Type_DriverRemoved)
+			self->bound = false;
+		return true;
+	}
 
-static uint32_t homeid;
+	switch (cb->GetType()) {
+	case OpenZWave::Notification::Type_DriverReady:
+	case OpenZWave::Notification::Type_DriverFailed:
+		if (OpenZWave::Manager::Get()->GetControllerPath(cb->GetHomeId()) != self->path)
+			return false;
+		if (cb->GetType() == OpenZWave::Notification::Type_DriverReady) {
+			self->bound = true;
+			self->bound_homeid = cb->GetHomeId();
+		}
+		return true;
+	default:
+		return false;
+	}
+}
 
 /*
- * Return the node for this request.
+ * Whether a notification passes the subscription filters, and so is to be
+ * emitted.  Driver-wide notifications are not tied to a node.
  */
-NodeInfo *get_node_info(uint8_t nodeid)
+static bool wanted(OZW *self, uint8_t type, uint8_t nodeid, uint8_t comclass)
 {
-	std::list<NodeInfo *>::iterator it;
-	NodeInfo *node;
+	if (!self->sub_types.test(type))
+		return false;
+
+	switch (type) {
+	case OpenZWave::Notification::Type_DriverReady:
+	case OpenZWave::Notification::Type_DriverFailed:
+	case OpenZWave::Notification::Type_DriverReset:
+	case OpenZWave::Notification::Type_DriverRemoved:
+	case OpenZWave::Notification::Type_AwakeNodesQueried:
+	case OpenZWave::Notification::Type_AllNodesQueried:
+	case OpenZWave::Notification::Type_AllNodesQueriedSomeDead:
+		return true;
+	case OpenZWave::Notification::Type_ValueAdded:
+	case OpenZWave::Notification::Type_ValueRemoved:
+	case OpenZWave::Notification::Type_ValueChanged:
+	case OpenZWave::Notification::Type_ValueRefreshed:
+		if (!self->sub_classes.test(comclass))
+			return false;
+		/* FALLTHROUGH */
+	default:
+		return self->sub_nodes.test(nodeid);
+	}
+}
 
-	for (it = znodes.begin(); it != znodes.end(); ++it) {
-		node = *it;
-		if (node->nodeid == nodeid)
-			return node;
+/*
+ * Whether a notification is to be queued at all.  The driver notifications
+ * are always needed.  Node and value topology carry state which we track
+ * ourselves whatever the subscription, so that it is complete when the
+ * filters are widened.  So do changes on a node with writes pending.  They
+ * are only filtered when they come to be emitted.  Refreshes are never
+ * emitted, and are only queued to complete writes.
+ */
+static bool subscribed(OZW *self, OpenZWave::Notification const *cb)
+{
+	switch (cb->GetType()) {
+	case OpenZWave::Notification::Type_DriverReady:
+	case OpenZWave::Notification::Type_DriverFailed:
+	case OpenZWave::Notification::Type_DriverReset:
+	case OpenZWave::Notification::Type_DriverRemoved:
+	case OpenZWave::Notification::Type_NodeAdded:
+	case OpenZWave::Notification::Type_NodeRemoved:
+	case OpenZWave::Notification::Type_ValueAdded:
+	case OpenZWave::Notification::Type_ValueRemoved:
+		return true;
+	case OpenZWave::Notification::Type_ValueRefreshed:
+		return self->zwriting.test(cb->GetNodeId());
+	case OpenZWave::Notification::Type_ValueChanged:
+		if (self->zwriting.test(cb->GetNodeId()))
+			return true;
+		/* FALLTHROUGH */
+	default:
+		return wanted(self, cb->GetType(), cb->GetNodeId(),
+		    cb->GetValueID().GetCommandClassId());
 	}
+}
 
-	return NULL;
+/*
+ * Track which nodes have completed their initial queries, for catalog mode.
+ * This must see every notification for our network, whether or not it has
+ * been subscribed to.
+ */
+static void update_catalog(OZW *self, OpenZWave::Notification const *cb)
+{
+	switch (cb->GetType()) {
+	case OpenZWave::Notification::Type_NodeAdded:
+	case OpenZWave::Notification::Type_NodeRemoved:
+		self->catalog_ready[cb->GetNodeId()] = false;
+		break;
+	case OpenZWave::Notification::Type_NodeQueriesComplete:
+		self->catalog_ready[cb->GetNodeId()] = true;
+		break;
+	case OpenZWave::Notification::Type_DriverReset:
+	case OpenZWave::Notification::Type_DriverRemoved:
+		memset(self->catalog_ready, 0, sizeof(self->catalog_ready));
+		break;
+	default:
+		break;
+	}
 }
 
 /*
@@ -109,12 +481,55 @@ NodeInfo *get_node_info(uint8_t nodeid)
  */
 void cb(OpenZWave::Notification const *cb, void *ctx)
 {
-	NotifInfo *notif = new NotifInfo();
+	OZW *self = (OZW *)ctx;
+	NotifQueue::Policy policy = NotifQueue::KEEP;
+	NotifInfo *notif;
+	uint32_t key = 0;
+	uint64_t t_read, t_frame, t_queue;
+	struct timeval tv;
+
+	if (!accept_notification(self, cb))
+		return;
+	if (self->value_catalog)
+		update_catalog(self, cb);
+	if (!subscribed(self, cb))
+		return;
+
+	notif = self->zqueue.reserve();
 
 	notif->type = cb->GetType();
 	notif->homeid = cb->GetHomeId();
 	notif->nodeid = cb->GetNodeId();
-	notif->values.push_front(cb->GetValueID());
+	notif->valueid = cb->GetValueID().GetId();
+	notif->groupidx = 0;
+	notif->event = 0;
+	notif->buttonid = 0;
+	notif->sceneid = 0;
+	notif->notification = 0;
+	notif->deferred = false;
+
+	gettimeofday(&tv, NULL);
+	notif->timestamp = ((uint64_t)tv.tv_sec * 1000) + (tv.tv_usec / 1000);
+
+	/*
+	 * Times are only set by the driver for notifications it queued
+	 * itself, and only those caused by a received frame have the first
+	 * two.
+	 */
+	t_read = cb->GetReadTime();
+	t_frame = cb->GetFrameTime();
+	t_queue = cb->GetQueueTime();
+	notif->t_cb = OpenZWave::TimeStamp::GetMonotonic();
+	notif->t_origin = t_read ? t_read : t_queue;
+	if (notif->type < 32) {
+		LatencyHistogram *lat = self->latency[notif->type];
+		if (t_read && t_frame >= t_read)
+			lat[LATENCY_READ].record(t_frame - t_read);
+		if (t_frame && t_queue >= t_frame)
+			lat[LATENCY_DISPATCH].record(t_queue - t_frame);
+		if (t_queue && notif->t_cb >= t_queue)
+			lat[LATENCY_NOTIFY].record(notif->t_cb - t_queue);
+	}
 
 	/*
 	 * Some values are only set on particular notifications, and
@@ -127,26 +542,572 @@ void cb(OpenZWave::Notification const *cb, void *ctx)
 		break;
 	case OpenZWave::Notification::Type_NodeEvent:
 		notif->event = cb->GetEvent();
+		policy = NotifQueue::DROPPABLE;
 		break;
 	case OpenZWave::Notification::Type_CreateButton:
 	case OpenZWave::Notification::Type_DeleteButton:
+		notif->buttonid = cb->GetButtonId();
+		break;
 	case OpenZWave::Notification::Type_ButtonOn:
 	case OpenZWave::Notification::Type_ButtonOff:
 		notif->buttonid = cb->GetButtonId();
+		policy = NotifQueue::DROPPABLE;
 		break;
 	case OpenZWave::Notification::Type_SceneEvent:
 		notif->sceneid = cb->GetSceneId();
+		policy = NotifQueue::DROPPABLE;
 		break;
 	case OpenZWave::Notification::Type_Notification:
 		notif->notification = cb->GetNotification();
 		break;
+	case OpenZWave::Notification::Type_ValueAdded:
+		OpenZWave::Manager::Get()->SetChangeVerified(cb->GetValueID(), true);
+		/*
+		 * In catalog mode the values found by a node's initial
+		 * queries are read in one pass when it is ready, so skip
+		 * the snapshot here.  Values which are not subscribed to
+		 * are left out of the catalog, so their metadata is taken
+		 * now.
+		 */
+		if (self->value_catalog && !self->catalog_ready[notif->nodeid] &&
+		    wanted(self, notif->type, notif->nodeid,
+		    cb->GetValueID().GetCommandClassId()))
+			notif->deferred = true;
+		else
+			snapshot_value(notif, cb->GetValueID());
+		key = ValueRegistry::key(cb->GetValueID());
+		break;
+	case OpenZWave::Notification::Type_ValueChanged:
+		snapshot_value(notif, cb->GetValueID());
+		key = ValueRegistry::key(cb->GetValueID());
+		policy = NotifQueue::COALESCE;
+		break;
+	case OpenZWave::Notification::Type_ValueRefreshed:
+		snapshot_value(notif, cb->GetValueID());
+		key = ValueRegistry::key(cb->GetValueID());
+		policy = NotifQueue::ABSORB;
+		break;
+	case OpenZWave::Notification::Type_ValueRemoved:
+		key = ValueRegistry::key(cb->GetValueID());
+		break;
+	case OpenZWave::Notification::Type_NodeAdded:
+	case OpenZWave::Notification::Type_NodeRemoved:
+	case OpenZWave::Notification::Type_DriverReset:
+	case OpenZWave::Notification::Type_DriverRemoved:
+		policy = NotifQueue::BARRIER;
+		break;
+	}
+
+	/*
+	 * Above the high-water mark this may coalesce or drop the
+	 * notification, see NotifQueue.
+	 */
+	self->zqueue.commit(policy, key);
+
+	uv_async_send(&self->async);
+}
+
+/*
+ * Return the cached metadata for a value, (re)creating it when the value is
+ * first added.
+ */
+static ValueMeta *get_value_meta(OZW *self, NotifInfo *notif,
+				 OpenZWave::ValueID const &value)
+{
+	uint32_t key = ValueRegistry::key(value);
+	ValueMeta *vm = self->zmeta.find(key);
+
+	if (vm && notif->type == OpenZWave::Notification::Type_ValueAdded) {
+		vm->label.Dispose();
+		vm->units.Dispose();
+		vm = NULL;
+	}
+	if (vm == NULL) {
+		vm = self->zmeta.insert(key);
+		vm->label = Persistent<String>::New(String::New(notif->label));
+		vm->units = Persistent<String>::New(String::New(notif->units));
+		vm->read_only = notif->read_only;
+		vm->write_only = notif->write_only;
+		vm->min = notif->min;
+		vm->max = notif->max;
+	}
+
+	return vm;
+}
+
+static void remove_value_meta(OZW *self, uint32_t key)
+{
+	ValueMeta *vm;
+
+	if ((vm = self->zmeta.find(key)) != NULL) {
+		vm->label.Dispose();
+		vm->units.Dispose();
+		self->zmeta.erase(key);
+	}
+}
+
+static void remove_node_meta(OZW *self, uint8_t nodeid)
+{
+	std::vector<uint32_t> keys;
+
+	for (uint32_t i = 0; i < self->zmeta.buckets(); i++) {
+		FlatMap<ValueMeta>::Slot *s = self->zmeta.bucket(i);
+		if (s && (s->key >> 24) == nodeid)
+			keys.push_back(s->key);
+	}
+	for (size_t i = 0; i < keys.size(); i++)
+		remove_value_meta(self, keys[i]);
+}
+
+/*
+ * Return the current values of a node, read in a single pass under the node
+ * lock, as objects in the same form as 'value added' with the command class
+ * in comclass.  For a catalog, only values of subscribed command classes are
+ * returned, and their metadata is cached as it would have been by 'value
+ * added'.
+ */
+static Local<Array> node_values(OZW *self, uint8_t nodeid, bool catalog)
+{
+	AddonData *d = self->data;
+	std::vector<OpenZWave::Node::ValueSnapshot> values;
+	uint32_t n = 0;
+
+	if (!OpenZWave::Manager::Get()->GetValuesSnapshot(self->homeid, nodeid, &values))
+		return Array::New();
+
+	Local<Array> result = Array::New();
+	for (size_t i = 0; i < values.size(); i++) {
+		OpenZWave::Node::ValueSnapshot const &v = values[i];
+		OpenZWave::ValueID value(self->homeid, (uint64)v.m_id);
+		Local<Object> valobj;
+		Local<String> label, units;
+
+		if (catalog) {
+			uint32_t key = ValueRegistry::key(value);
+			ValueMeta *vm;
+
+			if (!self->sub_classes.test(value.GetCommandClassId()))
+				continue;
+			if ((vm = self->zmeta.find(key)) == NULL) {
+				vm = self->zmeta.insert(key);
+				vm->label = Persistent<String>::New(String::New(v.m_label.c_str()));
+				vm->units = Persistent<String>::New(String::New(v.m_units.c_str()));
+				vm->read_only = v.m_readOnly;
+				vm->write_only = v.m_writeOnly;
+				vm->min = v.m_min;
+				vm->max = v.m_max;
+			}
+			label = Local<String>::New(vm->label);
+			units = Local<String>::New(vm->units);
+		} else {
+			label = String::New(v.m_label.c_str());
+			units = String::New(v.m_units.c_str());
+		}
+
+		valobj = d->value_tmpl->NewInstance();
+		valobj->Set(d->sym_type, d->type_names[value.GetType()]);
+		valobj->Set(d->sym_genre, d->genre_names[value.GetGenre()]);
+		valobj->Set(d->sym_instance, Integer::New(value.GetInstance()));
+		valobj->Set(d->sym_index, Integer::New(value.GetIndex()));
+		valobj->Set(d->sym_label, label);
+		valobj->Set(d->sym_units, units);
+		valobj->Set(d->sym_read_only, Boolean::New(v.m_readOnly));
+		valobj->Set(d->sym_write_only, Boolean::New(v.m_writeOnly));
+		valobj->Set(d->sym_min, Integer::New(v.m_min));
+		valobj->Set(d->sym_max, Integer::New(v.m_max));
+
+		/*
+		 * OpenZWave hands us the value as a string.
+		 */
+		switch (value.GetType()) {
+		case OpenZWave::ValueID::ValueType_Bool:
+			valobj->Set(d->sym_value, Boolean::New(v.m_value == "True"));
+			break;
+		case OpenZWave::ValueID::ValueType_Byte:
+		case OpenZWave::ValueID::ValueType_Decimal:
+		case OpenZWave::ValueID::ValueType_Int:
+		case OpenZWave::ValueID::ValueType_Short:
+			valobj->Set(d->sym_value, Number::New(strtod(v.m_value.c_str(), NULL)));
+			break;
+		case OpenZWave::ValueID::ValueType_List:
+		case OpenZWave::ValueID::ValueType_String:
+			valobj->Set(d->sym_value, String::New(v.m_value.c_str()));
+			break;
+		default:
+			break;
+		}
+		valobj->Set(d->sym_comclass, Integer::New(value.GetCommandClassId()));
+
+		result->Set(n++, valobj);
+	}
+
+	return result;
+}
+
+/*
+ * Append a ValueChanged notification to the binary record stream.
+ */
+static void write_record(OZW *self, NotifInfo *notif,
+			 OpenZWave::ValueID const &value)
+{
+	char *rec = self->record_data + (self->record_next * RECORD_SIZE);
+	double val, ts;
+
+	switch (value.GetType()) {
+	case OpenZWave::ValueID::ValueType_Bool:
+		val = notif->val.b;
+		break;
+	case OpenZWave::ValueID::ValueType_Byte:
+		val = notif->val.byte;
+		break;
+	case OpenZWave::ValueID::ValueType_Decimal:
+		val = notif->val.dec;
+		break;
+	case OpenZWave::ValueID::ValueType_Int:
+	case OpenZWave::ValueID::ValueType_List:
+		val = notif->val.i;
+		break;
+	case OpenZWave::ValueID::ValueType_Short:
+		val = notif->val.s;
+		break;
+	case OpenZWave::ValueID::ValueType_Button:
+		val = 0;
+		break;
+	default:
+		val = NAN;
+		break;
+	}
+	ts = notif->timestamp;
+
+	memset(rec, 0, RECORD_SIZE);
+	memcpy(rec, &notif->homeid, sizeof(uint32_t));
+	rec[4] = value.GetNodeId();
+	rec[5] = value.GetCommandClassId();
+	rec[6] = value.GetInstance();
+	rec[7] = value.GetIndex();
+	rec[8] = value.GetType();
+	memcpy(rec + 16, &val, sizeof(double));
+	memcpy(rec + 24, &ts, sizeof(double));
+
+	self->record_next = (self->record_next + 1) % self->record_cap;
+	self->record_pending++;
+}
+
+/*
+ * The events collected by one pass of the async handler in batched mode.
+ * Records which the batch refers to must not be overwritten before it has
+ * been delivered, so they are counted too.
+ */
+typedef struct {
+	Local<Array>		events;
+	uint32_t		count;
+	uint32_t		records;
+} EventBatch;
+
+static void batch_append(EventBatch *batch, Local<Value> *args, int argc)
+{
+	Local<Array> ev = Array::New(argc);
+
+	for (int i = 0; i < argc; i++)
+		ev->Set(i, args[i]);
+	batch->events->Set(batch->count++, ev);
+}
+
+/*
+ * Deliver the batch so far and start a new one.
+ */
+static void batch_emit(OZW *self, Handle<Function> emit, EventBatch *batch)
+{
+	Local<Value> args[2];
+
+	if (batch->count > 0) {
+		args[0] = String::New("events");
+		args[1] = batch->events;
+		MakeCallback(self->context_obj, emit, 2, args);
+	}
+
+	batch->events = Array::New();
+	batch->count = 0;
+	batch->records = 0;
+}
+
+/*
+ * Tell JavaScript about any records written since the last flush, as the
+ * index of the first record and the number of records, which may wrap
+ * around the end of the buffer.  In batched mode this is appended to the
+ * batch, so that it stays in order with the events around it.
+ */
+static void flush_records(OZW *self, Handle<Function> emit, EventBatch *batch)
+{
+	Local<Value> args[3];
+
+	if (self->record_pending == 0)
+		return;
+
+	args[0] = String::New("records");
+	args[1] = Integer::NewFromUnsigned(
+	    (self->record_next + self->record_cap - self->record_pending) % self->record_cap);
+	args[2] = Integer::NewFromUnsigned(self->record_pending);
+
+	if (batch) {
+		batch->records += self->record_pending;
+		batch_append(batch, args, 3);
+	} else {
+		MakeCallback(self->context_obj, emit, 3, args);
+	}
+	self->record_pending = 0;
+}
+
+/*
+ * Write a JavaScript value to an OpenZWave value, converting it according
+ * to the value type.
+ */
+static bool set_value(OpenZWave::ValueID const &vid, Handle<Value> arg)
+{
+	OpenZWave::Manager *mgr = OpenZWave::Manager::Get();
+
+	switch (vid.GetType()) {
+	case OpenZWave::ValueID::ValueType_Bool:
+		return mgr->SetValue(vid, (bool)arg->ToBoolean()->Value());
+	case OpenZWave::ValueID::ValueType_Byte:
+		return mgr->SetValue(vid, (uint8_t)arg->ToInteger()->Value());
+	case OpenZWave::ValueID::ValueType_Decimal:
+		return mgr->SetValue(vid, (float)arg->ToNumber()->NumberValue());
+	case OpenZWave::ValueID::ValueType_Int:
+		return mgr->SetValue(vid, (int32_t)arg->ToInteger()->Value());
+	case OpenZWave::ValueID::ValueType_Short:
+		return mgr->SetValue(vid, (int16_t)arg->ToInteger()->Value());
+	case OpenZWave::ValueID::ValueType_String:
+		return mgr->SetValue(vid, std::string(*String::Utf8Value(arg->ToString())));
+	default:
+		return false;
+	}
+}
+
+/*
+ * Record the outcome of a single write, and call back once the whole batch
+ * has finished.
+ */
+static void finish_write(OZW *self, PendingWrite const &pw, const char *error)
+{
+	AddonData *d = self->data;
+	WriteBatch *batch = pw.batch;
+	Local<Object> result = Object::New();
+
+	if (error)
+		result->Set(d->sym_error, String::New(error));
+	else
+		result->Set(d->sym_error, Null());
+	result->Set(d->sym_latency,
+		    Number::New((uv_hrtime() - pw.started) / 1e6));
+	batch->results->Set(pw.slot, result);
+
+	if (error)
+		batch->failed++;
+	if (--batch->remaining == 0)
+		self->zfinished.push_back(batch);
+}
+
+static std::list<PendingWrite>::iterator
+add_write(OZW *self, PendingWrite const &pw)
+{
+	(*self->zwrite_keys.insert(pw.key))++;
+	if (self->zwrite_nodes[pw.key >> 24]++ == 0)
+		self->zwriting.store(pw.key >> 24, true);
+
+	return self->zwrites.insert(self->zwrites.end(), pw);
+}
+
+static std::list<PendingWrite>::iterator
+remove_write(OZW *self, std::list<PendingWrite>::iterator it)
+{
+	uint32_t *pending;
+
+	if ((pending = self->zwrite_keys.find(it->key)) && --(*pending) == 0)
+		self->zwrite_keys.erase(it->key);
+	if (--self->zwrite_nodes[it->key >> 24] == 0)
+		self->zwriting.store(it->key >> 24, false);
+
+	return self->zwrites.erase(it);
+}
+
+/*
+ * Fail every pending write on a node.
+ */
+static void finish_writes(OZW *self, uint8_t nodeid, const char *error)
+{
+	std::list<PendingWrite>::iterator it;
+
+	for (it = self->zwrites.begin(); it != self->zwrites.end(); ) {
+		if ((it->key >> 24) == nodeid) {
+			finish_write(self, *it, error);
+			it = remove_write(self, it);
+		} else {
+			++it;
+		}
+	}
+}
+
+/*
+ * Keep the value a write sets, converted as set_value() does.
+ */
+static void written_value(PendingWrite *pw, OpenZWave::ValueID const &vid,
+			  Handle<Value> arg)
+{
+	switch (vid.GetType()) {
+	case OpenZWave::ValueID::ValueType_Bool:
+		pw->num = arg->ToBoolean()->Value();
+		break;
+	case OpenZWave::ValueID::ValueType_Byte:
+		pw->num = (uint8_t)arg->ToInteger()->Value();
+		break;
+	case OpenZWave::ValueID::ValueType_Decimal:
+		pw->num = (float)arg->ToNumber()->NumberValue();
+		break;
+	case OpenZWave::ValueID::ValueType_Int:
+		pw->num = (int32_t)arg->ToInteger()->Value();
+		break;
+	case OpenZWave::ValueID::ValueType_Short:
+		pw->num = (int16_t)arg->ToInteger()->Value();
+		break;
+	case OpenZWave::ValueID::ValueType_String:
+		pw->str = *String::Utf8Value(arg->ToString());
+		break;
+	default:
+		break;
+	}
+}
+
+/*
+ * Whether a report of a value shows the value a write set.  Decimals come
+ * back through the device's precision, so allow for rounding.
+ */
+static bool write_confirmed(PendingWrite const &pw, NotifInfo const *notif,
+			    OpenZWave::ValueID const &value)
+{
+	switch (value.GetType()) {
+	case OpenZWave::ValueID::ValueType_Bool:
+		return notif->val.b == (pw.num != 0);
+	case OpenZWave::ValueID::ValueType_Byte:
+		return notif->val.byte == pw.num;
+	case OpenZWave::ValueID::ValueType_Decimal:
+		return fabs(notif->val.dec - pw.num) < 0.001;
+	case OpenZWave::ValueID::ValueType_Int:
+		return notif->val.i == pw.num;
+	case OpenZWave::ValueID::ValueType_Short:
+		return notif->val.s == pw.num;
+	case OpenZWave::ValueID::ValueType_String:
+		return pw.str.compare(0, sizeof(notif->str) - 1, notif->str) == 0;
+	default:
+		return true;
 	}
+}
+
+/*
+ * Complete the pending writes on a reported value which set it to what the
+ * device now reports.  Any other report, such as one the device sent
+ * before the write reached it, leaves them pending.
+ */
+static void confirm_writes(OZW *self, NotifInfo const *notif)
+{
+	OpenZWave::ValueID value(notif->homeid, (uint64)notif->valueid);
+	uint32_t key = ValueRegistry::key(value);
+	std::list<PendingWrite>::iterator it;
+	uint32_t *pending;
+
+	if ((pending = self->zwrite_keys.find(key)) == NULL || *pending == 0)
+		return;
+
+	for (it = self->zwrites.begin(); it != self->zwrites.end(); ) {
+		if (it->key == key && write_confirmed(*it, notif, value)) {
+			finish_write(self, *it, NULL);
+			it = remove_write(self, it);
+		} else {
+			++it;
+		}
+	}
+}
+
+/*
+ * Call back any batches which have finished.
+ */
+static void call_finished(OZW *self)
+{
+	Local<Value> args[2];
+
+	while (!self->zfinished.empty()) {
+		WriteBatch *batch = self->zfinished.front();
+		self->zfinished.pop_front();
+
+		if (batch->failed) {
+			char msg[64];
+			snprintf(msg, sizeof(msg), "%u of %u writes failed",
+				 batch->failed, batch->results->Length());
+			args[0] = Exception::Error(String::New(msg));
+		} else {
+			args[0] = Local<Value>::New(Null());
+		}
+		args[1] = Local<Array>::New(batch->results);
+		MakeCallback(self->context_obj, batch->cb, 2, args);
+
+		batch->cb.Dispose();
+		batch->results.Dispose();
+		delete batch;
+	}
+}
+
+/*
+ * Periodically fail writes which have not been confirmed in time.
+ */
+static void write_timer_cb(uv_timer_t *handle, int status)
+{
+	HandleScope scope;
+	OZW *self = (OZW *)handle->data;
+	uint64_t expiry = uv_hrtime() - (self->write_timeout * 1000000ULL);
+	std::list<PendingWrite>::iterator it;
+
+	for (it = self->zwrites.begin(); it != self->zwrites.end(); ) {
+		if (it->started < expiry) {
+			finish_write(self, *it, "timeout");
+			it = remove_write(self, it);
+		} else {
+			++it;
+		}
+	}
+
+	call_finished(self);
+
+	if (self->zwrites.empty())
+		uv_timer_stop(&self->write_timer);
+}
+
+/*
+ * Call back batches which finished inside setValues().
+ */
+static void finish_timer_cb(uv_timer_t *handle, int status)
+{
+	HandleScope scope;
+	OZW *self = (OZW *)handle->data;
+
+	call_finished(self);
+}
+
+/*
+ * Record the latency of a notification which is about to be delivered.
+ */
+static void record_delivery(OZW *self, NotifInfo *notif)
+{
+	uint64_t now = OpenZWave::TimeStamp::GetMonotonic();
+	LatencyHistogram *lat;
 
-	pthread_mutex_lock(&zqueue_mutex);
-	zqueue.push(notif);
-	pthread_mutex_unlock(&zqueue_mutex);
+	if (notif->type >= 32)
+		return;
 
-	uv_async_send(&async);
+	lat = self->latency[notif->type];
+	if (now >= notif->t_cb)
+		lat[LATENCY_DELIVER].record(now - notif->t_cb);
+	if (notif->t_origin && now >= notif->t_origin)
+		lat[LATENCY_TOTAL].record(now - notif->t_origin);
 }
 
 /*
@@ -154,26 +1115,61 @@ void cb(OpenZWave::Notification const *cb, void *ctx)
  */
 void async_cb_handler(uv_async_t *handle, int status)
 {
+	HandleScope scope;
+	OZW *self = (OZW *)handle->data;
+	AddonData *d = self->data;
 	NodeInfo *node;
 	NotifInfo *notif;
 	Local<Value> args[16];
+	Local<Function> emit;
+	EventBatch batch, *bp = NULL;
+	bool want;
+	int argc;
+
+	if (self->batch_events) {
+		bp = &batch;
+		batch.events = Array::New();
+		batch.count = 0;
+		batch.records = 0;
+	}
+	emit = Local<Function>::Cast(self->context_obj->Get(d->sym_emit));
 
-	pthread_mutex_lock(&zqueue_mutex);
-
-	while (!zqueue.empty())
+	while ((notif = self->zqueue.front()) != NULL)
 	{
-		notif = zqueue.front();
+		OpenZWave::ValueID nvid(notif->homeid, (uint64)notif->valueid);
+
+		argc = 0;
+		want = wanted(self, notif->type, notif->nodeid,
+		    nvid.GetCommandClassId());
 
 		switch (notif->type) {
 		case OpenZWave::Notification::Type_DriverReady:
-			homeid = notif->homeid;
+			self->homeid = notif->homeid;
 			args[0] = String::New("driver ready");
-			args[1] = Integer::New(homeid);
-			MakeCallback(context_obj, "emit", 2, args);
+			args[1] = Integer::New(self->homeid);
+			argc = 2;
 			break;
 		case OpenZWave::Notification::Type_DriverFailed:
 			args[0] = String::New("driver failed");
-			MakeCallback(context_obj, "emit", 1, args);
+			argc = 1;
+			break;
+		/*
+		 * Our driver has gone, along with its nodes and values.  After
+		 * hardReset() they come back under a new home id.
+		 */
+		case OpenZWave::Notification::Type_DriverRemoved:
+			if (notif->homeid != self->homeid)
+				break;
+			for (int i = 0; i < 256; i++) {
+				if (self->znodes[i] == NULL)
+					continue;
+				finish_writes(self, i, "driver removed");
+				self->zvalues.remove_node(i);
+				remove_node_meta(self, i);
+				delete self->znodes[i];
+				self->znodes[i] = NULL;
+			}
+			self->homeid = 0;
 			break;
 		/*
 		 * NodeNew is triggered when a node is discovered which is not
@@ -185,16 +1181,22 @@ void async_cb_handler(uv_async_t *handle, int status)
 		case OpenZWave::Notification::Type_NodeNew:
 			break;
 		case OpenZWave::Notification::Type_NodeAdded:
-			node = new NodeInfo();
+			if ((node = self->znodes[notif->nodeid]) == NULL) {
+				node = new NodeInfo();
+				self->znodes[notif->nodeid] = node;
+			}
 			node->homeid = notif->homeid;
 			node->nodeid = notif->nodeid;
 			node->polled = false;
-			pthread_mutex_lock(&znodes_mutex);
-			znodes.push_back(node);
-			pthread_mutex_unlock(&znodes_mutex);
 			args[0] = String::New("node added");
 			args[1] = Integer::New(notif->nodeid);
-			MakeCallback(context_obj, "emit", 2, args);
+			argc = 2;
+			break;
+		case OpenZWave::Notification::Type_NodeRemoved:
+			self->zvalues.remove_node(notif->nodeid);
+			remove_node_meta(self, notif->nodeid);
+			delete self->znodes[notif->nodeid];
+			self->znodes[notif->nodeid] = NULL;
 			break;
 		/*
 		 * Ignore intermediate notifications about a node status, we
@@ -212,140 +1214,135 @@ void async_cb_handler(uv_async_t *handle, int status)
 		case OpenZWave::Notification::Type_ValueAdded:
 		case OpenZWave::Notification::Type_ValueChanged:
 		{
-			OpenZWave::ValueID value = notif->values.front();
-			Local<Object> valobj = Object::New();
-			const char *evname = (notif->type == OpenZWave::Notification::Type_ValueAdded)
-			    ? "value added" : "value changed";
-
-			if (notif->type == OpenZWave::Notification::Type_ValueAdded) {
-				if ((node = get_node_info(notif->nodeid))) {
-					pthread_mutex_lock(&znodes_mutex);
-					node->values.push_back(value);
-					pthread_mutex_unlock(&znodes_mutex);
+			OpenZWave::ValueID value(notif->homeid, (uint64)notif->valueid);
+			Local<Object> valobj;
+			ValueMeta *vm;
+
+			if (notif->type == OpenZWave::Notification::Type_ValueAdded)
+				self->zvalues.add(value);
+			else
+				confirm_writes(self, notif);
+
+			/*
+			 * Part of a node's catalog, which is delivered with
+			 * 'node ready'.  Forget any stale metadata, it is
+			 * cached again from the catalog.
+			 */
+			if (notif->deferred) {
+				remove_value_meta(self, ValueRegistry::key(value));
+				break;
+			}
+
+			vm = get_value_meta(self, notif, value);
+
+			/*
+			 * Tracked above, but not subscribed to.
+			 */
+			if (!want)
+				break;
+
+			/*
+			 * In binary mode changes only go to the record stream,
+			 * flushing early if the buffer has filled up.  A batch
+			 * which refers to records has to be delivered before
+			 * they are written over.
+			 */
+			if (self->binary_events &&
+			    notif->type == OpenZWave::Notification::Type_ValueChanged) {
+				write_record(self, notif, value);
+				record_delivery(self, notif);
+				if (self->record_pending + (bp ? bp->records : 0) ==
+				    self->record_cap) {
+					flush_records(self, emit, bp);
+					if (bp)
+						batch_emit(self, emit, bp);
 				}
-				OpenZWave::Manager::Get()->SetChangeVerified(value, true);
+				break;
 			}
 
+			valobj = d->value_tmpl->NewInstance();
+
 			/*
-			 * Common value types.
+			 * Common value types.  Everything other than the ValueID
+			 * itself was captured by the OpenZWave callback.
 			 */
-			valobj->Set(String::NewSymbol("type"),
-				    String::New(OpenZWave::Value::GetTypeNameFromEnum(value.GetType())));
-			valobj->Set(String::NewSymbol("genre"),
-				    String::New(OpenZWave::Value::GetGenreNameFromEnum(value.GetGenre())));
-			valobj->Set(String::NewSymbol("instance"),
-				    Integer::New(value.GetInstance()));
-			valobj->Set(String::NewSymbol("index"),
-				    Integer::New(value.GetIndex()));
-			valobj->Set(String::NewSymbol("label"),
-				    String::New(OpenZWave::Manager::Get()->GetValueLabel(value).c_str()));
-			valobj->Set(String::NewSymbol("units"),
-				    String::New(OpenZWave::Manager::Get()->GetValueUnits(value).c_str()));
-			valobj->Set(String::NewSymbol("read_only"),
-				    Boolean::New(OpenZWave::Manager::Get()->IsValueReadOnly(value))->ToBoolean());
-			valobj->Set(String::NewSymbol("write_only"),
-				    Boolean::New(OpenZWave::Manager::Get()->IsValueWriteOnly(value))->ToBoolean());
+			valobj->Set(d->sym_type, d->type_names[value.GetType()]);
+			valobj->Set(d->sym_genre, d->genre_names[value.GetGenre()]);
+			valobj->Set(d->sym_instance, Integer::New(value.GetInstance()));
+			valobj->Set(d->sym_index, Integer::New(value.GetIndex()));
+			valobj->Set(d->sym_label, vm->label);
+			valobj->Set(d->sym_units, vm->units);
+			valobj->Set(d->sym_read_only, Boolean::New(vm->read_only));
+			valobj->Set(d->sym_write_only, Boolean::New(vm->write_only));
 			// XXX: verify_changes=
 			// XXX: poll_intensity=
-			valobj->Set(String::NewSymbol("min"),
-				    Integer::New(OpenZWave::Manager::Get()->GetValueMin(value)));
-			valobj->Set(String::NewSymbol("max"),
-				    Integer::New(OpenZWave::Manager::Get()->GetValueMax(value)));
+			valobj->Set(d->sym_min, Integer::New(vm->min));
+			valobj->Set(d->sym_max, Integer::New(vm->max));
 
 			/*
 			 * The value itself is type-specific.
 			 */
 			switch (value.GetType()) {
 			case OpenZWave::ValueID::ValueType_Bool:
-			{
-				bool val;
-				OpenZWave::Manager::Get()->GetValueAsBool(value, &val);
-				valobj->Set(String::NewSymbol("value"), Boolean::New(val)->ToBoolean());
+				valobj->Set(d->sym_value, Boolean::New(notif->val.b));
 				break;
-			}
 			case OpenZWave::ValueID::ValueType_Byte:
-			{
-				uint8_t val;
-				OpenZWave::Manager::Get()->GetValueAsByte(value, &val);
-				valobj->Set(String::NewSymbol("value"), Integer::New(val));
+				valobj->Set(d->sym_value, Integer::New(notif->val.byte));
 				break;
-			}
 			case OpenZWave::ValueID::ValueType_Decimal:
-			{
-				float val;
-				OpenZWave::Manager::Get()->GetValueAsFloat(value, &val);
-				valobj->Set(String::NewSymbol("value"), Integer::New(val));
+				valobj->Set(d->sym_value, Number::New(notif->val.dec));
 				break;
-			}
 			case OpenZWave::ValueID::ValueType_Int:
-			{
-				int32_t val;
-				OpenZWave::Manager::Get()->GetValueAsInt(value, &val);
-				valobj->Set(String::NewSymbol("value"), Integer::New(val));
+				valobj->Set(d->sym_value, Integer::New(notif->val.i));
 				break;
-			}
-			case OpenZWave::ValueID::ValueType_List:
-			{
-				Local<Array> items;
-			}
 			case OpenZWave::ValueID::ValueType_Short:
-			{
-				int16_t val;
-				OpenZWave::Manager::Get()->GetValueAsShort(value, &val);
-				valobj->Set(String::NewSymbol("value"), Integer::New(val));
+				valobj->Set(d->sym_value, Integer::New(notif->val.s));
 				break;
-			}
+			/*
+			 * Lists report the current selection.
+			 */
+			case OpenZWave::ValueID::ValueType_List:
 			case OpenZWave::ValueID::ValueType_String:
-			{
-				std::string val;
-				OpenZWave::Manager::Get()->GetValueAsString(value, &val);
-				valobj->Set(String::NewSymbol("value"), String::New(val.c_str()));
+				valobj->Set(d->sym_value, String::New(notif->str));
 				break;
-			}
 			/*
 			 * Buttons do not have a value.
 			 */
 			case OpenZWave::ValueID::ValueType_Button:
-			{
 				break;
-			}
 			default:
 				fprintf(stderr, "unsupported value type: 0x%x\n", value.GetType());
 				break;
 			}
 
-			args[0] = String::New(evname);
+			args[0] = (notif->type == OpenZWave::Notification::Type_ValueAdded)
+			    ? d->ev_value_added : d->ev_value_changed;
 			args[1] = Integer::New(notif->nodeid);
 			args[2] = Integer::New(value.GetCommandClassId());
 			args[3] = valobj;
-			MakeCallback(context_obj, "emit", 4, args);
+			argc = 4;
 
 			break;
 		}
 		/*
 		 * A value update was sent but nothing changed, likely due to
-		 * the value just being polled.  Ignore, as we handle actual
+		 * the value just being polled or written with what it already
+		 * was.  Only used to complete writes, as we handle actual
 		 * changes above.
 		 */
 		case OpenZWave::Notification::Type_ValueRefreshed:
+			confirm_writes(self, notif);
 			break;
 		case OpenZWave::Notification::Type_ValueRemoved:
 		{
-			OpenZWave::ValueID value = notif->values.front();
-			std::list<OpenZWave::ValueID>::iterator vit;
-			if ((node = get_node_info(notif->nodeid))) {
-				for (vit = node->values.begin(); vit != node->values.end(); ++vit) {
-					if ((*vit) == notif->values.front()) {
-						node->values.erase(vit);
-						break;
-					}
-				}
-			}
+			OpenZWave::ValueID value(notif->homeid, (uint64)notif->valueid);
+			self->zvalues.remove(value);
+			remove_value_meta(self, ValueRegistry::key(value));
 			args[0] = String::New("value removed");
 			args[1] = Integer::New(notif->nodeid);
 			args[2] = Integer::New(value.GetCommandClassId());
 			args[3] = Integer::New(value.GetIndex());
-			MakeCallback(context_obj, "emit", 4, args);
+			argc = 4;
 			break;
 		}
 		/*
@@ -377,10 +1374,13 @@ void async_cb_handler(uv_async_t *handle, int status)
 			    String::New(OpenZWave::Manager::Get()->GetNodeName(notif->homeid, notif->nodeid).c_str()));
 			info->Set(String::NewSymbol("loc"),
 			    String::New(OpenZWave::Manager::Get()->GetNodeLocation(notif->homeid, notif->nodeid).c_str()));
+			if (self->value_catalog)
+				info->Set(String::NewSymbol("values"),
+				    node_values(self, notif->nodeid, true));
 			args[0] = String::New("node ready");
 			args[1] = Integer::New(notif->nodeid);
 			args[2] = info;
-			MakeCallback(context_obj, "emit", 3, args);
+			argc = 3;
 			break;
 		}
 		/*
@@ -391,16 +1391,18 @@ void async_cb_handler(uv_async_t *handle, int status)
 		case OpenZWave::Notification::Type_AllNodesQueried:
 		case OpenZWave::Notification::Type_AllNodesQueriedSomeDead:
 			args[0] = String::New("scan complete");
-			MakeCallback(context_obj, "emit", 1, args);
+			argc = 1;
 			break;
 		/*
 		 * A general notification.
 		 */
 		case OpenZWave::Notification::Type_Notification:
+			if (notif->notification == OpenZWave::Notification::Code_Dead)
+				finish_writes(self, notif->nodeid, "node dead");
 			args[0] = String::New("notification");
 			args[1] = Integer::New(notif->nodeid);
 			args[2] = Integer::New(notif->notification);
-			MakeCallback(context_obj, "emit", 3, args);
+			argc = 3;
 			break;
 		/*
 		 * Send unhandled events to stderr so we can monitor them if
@@ -411,10 +1413,52 @@ void async_cb_handler(uv_async_t *handle, int status)
 			break;
 		}
 
-		zqueue.pop();
+		/*
+		 * In batched mode each event is appended to the batch as an
+		 * array of [name, args...], otherwise emit it straight away.
+		 * Either way any records written before it come first.
+		 */
+		if (argc > 0 && want) {
+			record_delivery(self, notif);
+			flush_records(self, emit, bp);
+			if (bp)
+				batch_append(bp, args, argc);
+			else
+				MakeCallback(self->context_obj, emit, argc, args);
+		}
+
+		self->zqueue.pop();
 	}
 
-	pthread_mutex_unlock(&zqueue_mutex);
+	flush_records(self, emit, bp);
+	call_finished(self);
+
+	if (bp)
+		batch_emit(self, emit, bp);
+}
+
+/*
+ * Create the process-wide OpenZWave options.  They can only be set once, so
+ * the first instance to connect decides them for all.
+ */
+static void create_options(DriverOptions const &o)
+{
+	OpenZWave::Options::Create(o.confpath.c_str(), "", "");
+	OpenZWave::Options::Get()->AddOptionBool("ConsoleOutput", o.consoleoutput);
+	OpenZWave::Options::Get()->AddOptionBool("Logging", o.logging);
+	OpenZWave::Options::Get()->AddOptionBool("SaveConfiguration", o.saveconfig);
+	OpenZWave::Options::Get()->AddOptionInt("DriverMaxAttempts", o.driverattempts);
+	OpenZWave::Options::Get()->AddOptionInt("PollInterval", o.pollinterval);
+	OpenZWave::Options::Get()->AddOptionBool("IntervalBetweenPolls", true);
+	/*
+	 * Refreshes are needed to confirm writes which leave a value as it
+	 * was.  Those which are not are dropped by our callback instead.
+	 */
+	OpenZWave::Options::Get()->AddOptionBool("SuppressValueRefresh", false);
+	OpenZWave::Options::Get()->AddOptionInt("RetryTimeout", o.retrytimeout);
+	OpenZWave::Options::Get()->AddOptionInt("RetryTimeoutMin", o.minretrytimeout);
+	OpenZWave::Options::Get()->AddOptionInt("FreshPollPercent", o.freshpollpercent);
+	OpenZWave::Options::Get()->Lock();
 }
 
 Handle<Value> OZW::New(const Arguments& args)
@@ -422,25 +1466,53 @@ Handle<Value> OZW::New(const Arguments& args)
 	HandleScope scope;
 
 	assert(args.IsConstructCall());
-	OZW* self = new OZW();
+	OZW* self = new OZW((AddonData *)External::Unwrap(args.Data()));
 	self->Wrap(args.This());
 
+	/*
+	 * The OpenZWave watcher holds on to us, so the object must never be
+	 * collected.
+	 */
+	self->context_obj = Persistent<Object>::New(args.This());
+
 	Local<Object> opts = args[0]->ToObject();
-	std::string confpath = (*String::Utf8Value(opts->Get(String::New("modpath")->ToString())));
-	confpath += "/../deps/open-zwave/config";
+	self->options.confpath = (*String::Utf8Value(opts->Get(String::New("modpath")->ToString())));
+	self->options.confpath += "/../deps/open-zwave/config";
+	self->options.consoleoutput = opts->Get(String::New("consoleoutput"))->BooleanValue();
+	self->options.logging = opts->Get(String::New("logging"))->BooleanValue();
+	self->options.saveconfig = opts->Get(String::New("saveconfig"))->BooleanValue();
+	self->options.driverattempts = opts->Get(String::New("driverattempts"))->IntegerValue();
+	self->options.pollinterval = opts->Get(String::New("pollinterval"))->IntegerValue();
+	self->options.retrytimeout = opts->Get(String::New("retrytimeout"))->IntegerValue();
+	self->options.minretrytimeout = opts->Get(String::New("minretrytimeout"))->IntegerValue();
+	self->options.freshpollpercent = opts->Get(String::New("freshpollpercent"))->IntegerValue();
+
+	self->batch_events = opts->Get(String::New("batchevents"))->BooleanValue();
+	self->value_catalog = opts->Get(String::New("valuecatalog"))->BooleanValue();
+	self->write_timeout = opts->Get(String::New("writetimeout"))->Uint32Value();
 
 	/*
-	 * Options are global for all drivers and can only be set once.
+	 * The record buffer is handed to JavaScript by getRecordBuffer().
 	 */
-	OpenZWave::Options::Create(confpath.c_str(), "", "");
-	OpenZWave::Options::Get()->AddOptionBool("ConsoleOutput", opts->Get(String::New("consoleoutput"))->BooleanValue());
-	OpenZWave::Options::Get()->AddOptionBool("Logging", opts->Get(String::New("logging"))->BooleanValue());
-	OpenZWave::Options::Get()->AddOptionBool("SaveConfiguration", opts->Get(String::New("saveconfig"))->BooleanValue());
-	OpenZWave::Options::Get()->AddOptionInt("DriverMaxAttempts", opts->Get(String::New("driverattempts"))->IntegerValue());
-	OpenZWave::Options::Get()->AddOptionInt("PollInterval", opts->Get(String::New("pollinterval"))->IntegerValue());
-	OpenZWave::Options::Get()->AddOptionBool("IntervalBetweenPolls", true);
-	OpenZWave::Options::Get()->AddOptionBool("SuppressValueRefresh", opts->Get(String::New("suppressrefresh"))->BooleanValue());
-	OpenZWave::Options::Get()->Lock();
+	self->binary_events = opts->Get(String::New("binaryevents"))->BooleanValue();
+	if (self->binary_events) {
+		self->record_cap = opts->Get(String::New("recordbuffer"))->Uint32Value();
+		if (self->record_cap == 0)
+			self->record_cap = 1;
+		node::Buffer *buf = node::Buffer::New(self->record_cap * RECORD_SIZE);
+		self->record_buf = Persistent<Object>::New(buf->handle_);
+		self->record_data = node::Buffer::Data(self->record_buf);
+	}
+
+	/*
+	 * The notification ring is allocated once, up front.
+	 */
+	if (!self->zqueue.init(opts->Get(String::New("queuesize"))->Uint32Value(),
+	    opts->Get(String::New("highwater"))->Uint32Value())) {
+		ThrowException(Exception::Error(
+		    String::New("unable to allocate notification queue")));
+		return scope.Close(Undefined());
+	}
 
 	return scope.Close(args.This());
 }
@@ -448,98 +1520,186 @@ Handle<Value> OZW::New(const Arguments& args)
 Handle<Value> OZW::Connect(const Arguments& args)
 {
 	HandleScope scope;
+	OZW* self = ObjectWrap::Unwrap<OZW>(args.This());
 
-	std::string path = (*String::Utf8Value(args[0]->ToString()));
+	if (self->connected)
+		return scope.Close(Undefined());
 
-	uv_async_init(uv_default_loop(), &async, async_cb_handler);
+	self->path = (*String::Utf8Value(args[0]->ToString()));
+	self->bound = false;
+	self->bound_homeid = 0;
+	self->connected = true;
 
-	context_obj = Persistent<Object>::New(args.This());
+	uv_ref((uv_handle_t *)&self->async);
 
-	OpenZWave::Manager::Create();
-	OpenZWave::Manager::Get()->AddWatcher(cb, NULL);
-	OpenZWave::Manager::Get()->AddDriver(path);
+	pthread_mutex_lock(&manager_lock);
+	if (manager_refs++ == 0) {
+		create_options(self->options);
+		OpenZWave::Manager::Create();
+	}
+	OpenZWave::Manager::Get()->AddWatcher(cb, self);
+	OpenZWave::Manager::Get()->AddDriver(self->path);
+	pthread_mutex_unlock(&manager_lock);
 
 	Handle<Value> argv[1] = { String::New("connected") };
-	MakeCallback(context_obj, "emit", 1, argv);
+	MakeCallback(self->context_obj, "emit", 1, argv);
 
-	return Undefined();
+	return scope.Close(Undefined());
 }
 
 Handle<Value> OZW::Disconnect(const Arguments& args)
 {
 	HandleScope scope;
+	OZW* self = ObjectWrap::Unwrap<OZW>(args.This());
 
-	std::string path = (*String::Utf8Value(args[0]->ToString()));
+	if (!self->connected)
+		return scope.Close(Undefined());
 
-	OpenZWave::Manager::Get()->RemoveDriver(path);
-	OpenZWave::Manager::Get()->RemoveWatcher(cb, NULL);
-	OpenZWave::Manager::Destroy();
-	OpenZWave::Options::Destroy();
+	pthread_mutex_lock(&manager_lock);
+	OpenZWave::Manager::Get()->RemoveDriver(self->path);
+	OpenZWave::Manager::Get()->RemoveWatcher(cb, self);
+	if (--manager_refs == 0) {
+		OpenZWave::Manager::Destroy();
+		OpenZWave::Options::Destroy();
+	}
+	pthread_mutex_unlock(&manager_lock);
+
+	self->connected = false;
+
+	uv_unref((uv_handle_t *)&self->async);
 
 	return scope.Close(Undefined());
 }
 
+/*
+ * Reopen the controller after it has gone away, without tearing down the
+ * Manager or our driver, so that neither the configuration nor the node
+ * information has to be read again.
+ */
+Handle<Value> OZW::Reconnect(const Arguments& args)
+{
+	HandleScope scope;
+	OZW* self = ObjectWrap::Unwrap<OZW>(args.This());
+
+	if (!self->connected)
+		return scope.Close(Boolean::New(false));
+
+	pthread_mutex_lock(&manager_lock);
+	bool ok = OpenZWave::Manager::Get()->ReconnectDriver(self->path);
+	pthread_mutex_unlock(&manager_lock);
+
+	return scope.Close(Boolean::New(ok));
+}
+
 /*
  * Generic value set.
  */
 Handle<Value> OZW::SetValue(const Arguments& args)
 {
 	HandleScope scope;
+	OZW* self = ObjectWrap::Unwrap<OZW>(args.This());
 
 	uint8_t nodeid = args[0]->ToNumber()->Value();
 	uint8_t comclass = args[1]->ToNumber()->Value();
 	uint8_t index = args[2]->ToNumber()->Value();
 
-	NodeInfo *node;
-	std::list<OpenZWave::ValueID>::iterator vit;
-
-	if ((node = get_node_info(nodeid))) {
-		for (vit = node->values.begin(); vit != node->values.end(); ++vit) {
-			if (((*vit).GetCommandClassId() == comclass) &&
-			    ((*vit).GetIndex() == index)) {
-
-				switch ((*vit).GetType()) {
-				case OpenZWave::ValueID::ValueType_Bool:
-				{
-					bool val = args[3]->ToBoolean()->Value();
-					OpenZWave::Manager::Get()->SetValue(*vit, val);
-					break;
-				}
-				case OpenZWave::ValueID::ValueType_Byte:
-				{
-					uint8_t val = args[3]->ToInteger()->Value();
-					OpenZWave::Manager::Get()->SetValue(*vit, val);
-					break;
-				}
-				case OpenZWave::ValueID::ValueType_Decimal:
-				{
-					float val = args[3]->ToNumber()->NumberValue();
-					OpenZWave::Manager::Get()->SetValue(*vit, val);
-					break;
-				}
-				case OpenZWave::ValueID::ValueType_Int:
-				{
-					int32_t val = args[3]->ToInteger()->Value();
-					OpenZWave::Manager::Get()->SetValue(*vit, val);
-					break;
-				}
-				case OpenZWave::ValueID::ValueType_Short:
-				{
-					int16_t val = args[3]->ToInteger()->Value();
-					OpenZWave::Manager::Get()->SetValue(*vit, val);
-					break;
-				}
-				case OpenZWave::ValueID::ValueType_String:
-				{
-					std::string val = (*String::Utf8Value(args[3]->ToString()));
-					OpenZWave::Manager::Get()->SetValue(*vit, val);
-					break;
-				}
-				}
-			}
+	OpenZWave::ValueID vid(0, (uint64)0);
+
+	/*
+	 * An instance may be given after the value to write only that one,
+	 * otherwise every instance with a matching index is written.
+	 */
+	if (!args[4]->IsUndefined()) {
+		uint8_t instance = args[4]->ToNumber()->Value();
+		if (self->zvalues.lookup(nodeid, comclass, instance, index, &vid))
+			set_value(vid, args[3]);
+	} else {
+		std::vector<OpenZWave::ValueID> vids;
+		self->zvalues.lookup_instances(nodeid, comclass, index, &vids);
+		for (size_t i = 0; i < vids.size(); i++)
+			set_value(vids[i], args[3]);
+	}
+
+	return scope.Close(Undefined());
+}
+
+/*
+ * Queue a batch of writes in one call, and call back once all of them have
+ * been confirmed by the device or have failed.  Each write is an object of
+ * {nodeid, comclass, instance, index, value}, where instance defaults to 1.
+ */
+Handle<Value> OZW::SetValues(const Arguments& args)
+{
+	HandleScope scope;
+	OZW* self = ObjectWrap::Unwrap<OZW>(args.This());
+	AddonData *d = self->data;
+
+	if (!args[0]->IsArray() || !args[1]->IsFunction()) {
+		ThrowException(Exception::TypeError(
+		    String::New("setValues(writes, callback)")));
+		return scope.Close(Undefined());
+	}
+
+	Local<Array> writes = Local<Array>::Cast(args[0]);
+	uint32_t count = writes->Length();
+	WriteBatch *batch = new WriteBatch();
+	uint64_t now = uv_hrtime();
+
+	batch->cb = Persistent<Function>::New(Local<Function>::Cast(args[1]));
+	batch->results = Persistent<Array>::New(Array::New(count));
+	batch->remaining = count;
+	batch->failed = 0;
+
+	for (uint32_t i = 0; i < count; i++) {
+		Local<Object> w = writes->Get(i)->ToObject();
+		Local<Value> inst = w->Get(d->sym_instance);
+		uint8_t nodeid = w->Get(d->sym_nodeid)->ToNumber()->Value();
+		uint8_t comclass = w->Get(d->sym_comclass)->ToNumber()->Value();
+		uint8_t instance = inst->IsUndefined() ? 1 : inst->ToNumber()->Value();
+		uint8_t index = w->Get(d->sym_index)->ToNumber()->Value();
+		OpenZWave::ValueID vid(0, (uint64)0);
+		std::list<PendingWrite>::iterator pit;
+		PendingWrite pw;
+
+		pw.batch = batch;
+		pw.slot = i;
+		pw.key = ValueRegistry::key(nodeid, comclass, instance, index);
+		pw.started = now;
+		pw.num = 0;
+
+		if (!self->zvalues.lookup(nodeid, comclass, instance, index, &vid)) {
+			finish_write(self, pw, "unknown value");
+			continue;
+		}
+
+		/*
+		 * Pending before it is sent, so that the callback does not
+		 * filter out a quick reply.
+		 */
+		written_value(&pw, vid, w->Get(d->sym_value));
+		pit = add_write(self, pw);
+		if (!set_value(vid, w->Get(d->sym_value))) {
+			remove_write(self, pit);
+			finish_write(self, pw, "rejected");
 		}
 	}
 
+	/*
+	 * Batches which have already finished, because they were empty or
+	 * every write failed, are called back on the next turn of the loop
+	 * rather than synchronously.  The timeout timer is left alone if it
+	 * is already running, so that steady calls do not keep putting off
+	 * its next check.
+	 */
+	if (count == 0)
+		self->zfinished.push_back(batch);
+
+	if (!self->zfinished.empty())
+		uv_timer_start(&self->finish_timer, finish_timer_cb, 0, 0);
+	if (!self->zwrites.empty() &&
+	    !uv_is_active((uv_handle_t *)&self->write_timer))
+		uv_timer_start(&self->write_timer, write_timer_cb, 250, 250);
+
 	return scope.Close(Undefined());
 }
 
@@ -549,21 +1709,15 @@ Handle<Value> OZW::SetValue(const Arguments& args)
 Handle<Value> OZW::SetLevel(const Arguments& args)
 {
 	HandleScope scope;
+	OZW* self = ObjectWrap::Unwrap<OZW>(args.This());
 
 	uint8_t nodeid = args[0]->ToNumber()->Value();
 	uint8_t value = args[1]->ToNumber()->Value();
 
-	NodeInfo *node;
-	std::list<OpenZWave::ValueID>::iterator vit;
+	OpenZWave::ValueID vid(0, (uint64)0);
 
-	if ((node = get_node_info(nodeid))) {
-		for (vit = node->values.begin(); vit != node->values.end(); ++vit) {
-			if ((*vit).GetCommandClassId() == 0x26 && (*vit).GetIndex() == 0) {
-				OpenZWave::Manager::Get()->SetValue(*vit, value);
-				break;
-			}
-		}
-	}
+	if (self->zvalues.lookup_first_instance(nodeid, 0x26, 0, &vid))
+		OpenZWave::Manager::Get()->SetValue(vid, value);
 
 	return scope.Close(Undefined());
 }
@@ -574,11 +1728,12 @@ Handle<Value> OZW::SetLevel(const Arguments& args)
 Handle<Value> OZW::SetLocation(const Arguments& args)
 {
 	HandleScope scope;
+	OZW* self = ObjectWrap::Unwrap<OZW>(args.This());
 
 	uint8_t nodeid = args[0]->ToNumber()->Value();
 	std::string location = (*String::Utf8Value(args[1]->ToString()));
 
-	OpenZWave::Manager::Get()->SetNodeLocation(homeid, nodeid, location);
+	OpenZWave::Manager::Get()->SetNodeLocation(self->homeid, nodeid, location);
 
 	return scope.Close(Undefined());
 }
@@ -589,11 +1744,12 @@ Handle<Value> OZW::SetLocation(const Arguments& args)
 Handle<Value> OZW::SetName(const Arguments& args)
 {
 	HandleScope scope;
+	OZW* self = ObjectWrap::Unwrap<OZW>(args.This());
 
 	uint8_t nodeid = args[0]->ToNumber()->Value();
 	std::string name = (*String::Utf8Value(args[1]->ToString()));
 
-	OpenZWave::Manager::Get()->SetNodeName(homeid, nodeid, name);
+	OpenZWave::Manager::Get()->SetNodeName(self->homeid, nodeid, name);
 
 	return scope.Close(Undefined());
 }
@@ -601,35 +1757,30 @@ Handle<Value> OZW::SetName(const Arguments& args)
 /*
  * Switch a COMMAND_CLASS_SWITCH_BINARY on/off
  */
-void set_switch(uint8_t nodeid, bool state)
+static void set_switch(OZW *self, uint8_t nodeid, bool state)
 {
-	NodeInfo *node;
-	std::list<OpenZWave::ValueID>::iterator vit;
+	OpenZWave::ValueID vid(0, (uint64)0);
 
-	if ((node = get_node_info(nodeid))) {
-		for (vit = node->values.begin(); vit != node->values.end(); ++vit) {
-			if ((*vit).GetCommandClassId() == 0x25) {
-				OpenZWave::Manager::Get()->SetValue(*vit, state);
-				break;
-			}
-		}
-	}
+	if (self->zvalues.lookup_class(nodeid, 0x25, &vid))
+		OpenZWave::Manager::Get()->SetValue(vid, state);
 }
 Handle<Value> OZW::SwitchOn(const Arguments& args)
 {
 	HandleScope scope;
+	OZW* self = ObjectWrap::Unwrap<OZW>(args.This());
 
 	uint8_t nodeid = args[0]->ToNumber()->Value();
-	set_switch(nodeid, true);
+	set_switch(self, nodeid, true);
 
 	return scope.Close(Undefined());
 }
 Handle<Value> OZW::SwitchOff(const Arguments& args)
 {
 	HandleScope scope;
+	OZW* self = ObjectWrap::Unwrap<OZW>(args.This());
 
 	uint8_t nodeid = args[0]->ToNumber()->Value();
-	set_switch(nodeid, false);
+	set_switch(self, nodeid, false);
 
 	return scope.Close(Undefined());
 }
@@ -640,19 +1791,21 @@ Handle<Value> OZW::SwitchOff(const Arguments& args)
 Handle<Value> OZW::EnablePoll(const Arguments& args)
 {
 	HandleScope scope;
+	OZW* self = ObjectWrap::Unwrap<OZW>(args.This());
 
 	uint8_t nodeid = args[0]->ToNumber()->Value();
 	uint8_t comclass = args[1]->ToNumber()->Value();
-	NodeInfo *node;
-	std::list<OpenZWave::ValueID>::iterator vit;
+	OpenZWave::ValueID vid(0, (uint64)0);
 
-	if ((node = get_node_info(nodeid))) {
-		for (vit = node->values.begin(); vit != node->values.end(); ++vit) {
-			if ((*vit).GetCommandClassId() == comclass) {
-				OpenZWave::Manager::Get()->EnablePoll((*vit), 1);
-				break;
-			}
-		}
+	if (self->zvalues.lookup_class(nodeid, comclass, &vid)) {
+		OpenZWave::Manager::Get()->EnablePoll(vid, 1);
+		/*
+		 * An optional interval in milliseconds for this value,
+		 * otherwise it is worked out from pollinterval.
+		 */
+		if (args.Length() > 2 && args[2]->IsNumber())
+			OpenZWave::Manager::Get()->SetPollInterval(vid,
+			    args[2]->ToNumber()->Value());
 	}
 
 	return scope.Close(Undefined());
@@ -660,20 +1813,14 @@ Handle<Value> OZW::EnablePoll(const Arguments& args)
 Handle<Value> OZW::DisablePoll(const Arguments& args)
 {
 	HandleScope scope;
+	OZW* self = ObjectWrap::Unwrap<OZW>(args.This());
 
 	uint8_t nodeid = args[0]->ToNumber()->Value();
 	uint8_t comclass = args[1]->ToNumber()->Value();
-	NodeInfo *node;
-	std::list<OpenZWave::ValueID>::iterator vit;
+	OpenZWave::ValueID vid(0, (uint64)0);
 
-	if ((node = get_node_info(nodeid))) {
-		for (vit = node->values.begin(); vit != node->values.end(); ++vit) {
-			if ((*vit).GetCommandClassId() == comclass) {
-				OpenZWave::Manager::Get()->DisablePoll((*vit));
-				break;
-			}
-		}
-	}
+	if (self->zvalues.lookup_class(nodeid, comclass, &vid))
+		OpenZWave::Manager::Get()->DisablePoll(vid);
 
 	return scope.Close(Undefined());
 }
@@ -685,40 +1832,479 @@ Handle<Value> OZW::DisablePoll(const Arguments& args)
 Handle<Value> OZW::HardReset(const Arguments& args)
 {
 	HandleScope scope;
+	OZW* self = ObjectWrap::Unwrap<OZW>(args.This());
 
-	OpenZWave::Manager::Get()->ResetController(homeid);
+	OpenZWave::Manager::Get()->ResetController(self->homeid);
 
 	return scope.Close(Undefined());
 }
 Handle<Value> OZW::SoftReset(const Arguments& args)
 {
 	HandleScope scope;
+	OZW* self = ObjectWrap::Unwrap<OZW>(args.This());
+
+	OpenZWave::Manager::Get()->SoftReset(self->homeid);
+
+	return scope.Close(Undefined());
+}
+
+/*
+ * Return statistics about the notification queue.
+ */
+Handle<Value> OZW::GetQueueStats(const Arguments& args)
+{
+	HandleScope scope;
+	OZW* self = ObjectWrap::Unwrap<OZW>(args.This());
+	uint64_t oldest, now, age = 0;
+	struct timeval tv;
+
+	Local<Object> stats = Object::New();
+	stats->Set(String::NewSymbol("capacity"),
+		   Integer::NewFromUnsigned(self->zqueue.capacity()));
+	stats->Set(String::NewSymbol("depth"),
+		   Integer::NewFromUnsigned(self->zqueue.depth()));
+	stats->Set(String::NewSymbol("highwater"),
+		   Integer::NewFromUnsigned(self->zqueue.highwatermark()));
+	stats->Set(String::NewSymbol("overflows"),
+		   Integer::NewFromUnsigned(self->zqueue.overflowed()));
+	stats->Set(String::NewSymbol("coalesced"),
+		   Integer::NewFromUnsigned(self->zqueue.coalesced_count()));
+
+	/*
+	 * Age in ms of the oldest notification not yet delivered, which is
+	 * how far behind JavaScript is.
+	 */
+	if ((oldest = self->zqueue.oldest()) != 0) {
+		gettimeofday(&tv, NULL);
+		now = ((uint64_t)tv.tv_sec * 1000) + (tv.tv_usec / 1000);
+		age = (now > oldest) ? now - oldest : 0;
+	}
+	stats->Set(String::NewSymbol("oldest"), Number::New(age));
+
+	return scope.Close(stats);
+}
+
+/*
+ * Names of OpenZWave notification types, indexed by type, used to report
+ * latency statistics.
+ */
+static const char *notif_type_names[] = {
+	"ValueAdded", "ValueRemoved", "ValueChanged", "ValueRefreshed",
+	"Group", "NodeNew", "NodeAdded", "NodeRemoved", "NodeProtocolInfo",
+	"NodeNaming", "NodeEvent", "PollingDisabled", "PollingEnabled",
+	"SceneEvent", "CreateButton", "DeleteButton", "ButtonOn", "ButtonOff",
+	"DriverReady", "DriverFailed", "DriverReset",
+	"EssentialNodeQueriesComplete", "NodeQueriesComplete",
+	"AwakeNodesQueried", "AllNodesQueriedSomeDead", "AllNodesQueried",
+	"Notification", "DriverRemoved",
+};
+
+static const char *latency_stage_names[LATENCY_STAGES] = {
+	"read", "dispatch", "notify", "deliver", "total",
+};
+
+static Local<Object> latency_object(LatencyHistogram const &h)
+{
+	Local<Object> obj = Object::New();
+
+	/*
+	 * Histograms are kept in us, but reported in ms like everything
+	 * else.
+	 */
+	obj->Set(String::NewSymbol("count"), Number::New(h.count()));
+	obj->Set(String::NewSymbol("p50"), Number::New(h.percentile(50) / 1000.0));
+	obj->Set(String::NewSymbol("p90"), Number::New(h.percentile(90) / 1000.0));
+	obj->Set(String::NewSymbol("p99"), Number::New(h.percentile(99) / 1000.0));
+	obj->Set(String::NewSymbol("max"), Number::New(h.max() / 1000.0));
+
+	return obj;
+}
+
+/*
+ * Return latency percentiles for each stage of delivery, overall and per
+ * notification type, optionally resetting them.
+ */
+Handle<Value> OZW::GetLatencyStats(const Arguments& args)
+{
+	HandleScope scope;
+	OZW* self = ObjectWrap::Unwrap<OZW>(args.This());
+	Local<Object> stats = Object::New();
+	Local<Object> stages = Object::New();
+	Local<Object> types = Object::New();
+	LatencyHistogram all[LATENCY_STAGES];
+	uint32_t ntypes = sizeof(notif_type_names) / sizeof(notif_type_names[0]);
+
+	for (uint32_t t = 0; t < ntypes; t++) {
+		Local<Object> type;
+		bool seen = false;
+
+		for (int s = 0; s < LATENCY_STAGES; s++) {
+			LatencyHistogram &h = self->latency[t][s];
+			if (h.count() == 0)
+				continue;
+			if (!seen) {
+				type = Object::New();
+				types->Set(String::NewSymbol(notif_type_names[t]), type);
+				seen = true;
+			}
+			type->Set(String::NewSymbol(latency_stage_names[s]),
+				  latency_object(h));
+			all[s].merge(h);
+		}
+	}
+
+	for (int s = 0; s < LATENCY_STAGES; s++)
+		stages->Set(String::NewSymbol(latency_stage_names[s]),
+			    latency_object(all[s]));
+
+	stats->Set(String::NewSymbol("stages"), stages);
+	stats->Set(String::NewSymbol("types"), types);
+
+	if (args.Length() > 0 && args[0]->BooleanValue()) {
+		for (uint32_t t = 0; t < 32; t++)
+			for (int s = 0; s < LATENCY_STAGES; s++)
+				self->latency[t][s].reset();
+	}
+
+	return scope.Close(stats);
+}
+
+/*
+ * Return the driver's message counters.
+ */
+Handle<Value> OZW::GetDriverStats(const Arguments& args)
+{
+	HandleScope scope;
+	OZW* self = ObjectWrap::Unwrap<OZW>(args.This());
+	OpenZWave::Driver::DriverData data;
+
+	if (self->homeid == 0)
+		return scope.Close(Object::New());
+
+	OpenZWave::Manager::Get()->GetDriverStatistics(self->homeid, &data);
+
+	Local<Object> stats = Object::New();
+	stats->Set(String::NewSymbol("read"),
+		   Integer::NewFromUnsigned(data.m_readCnt));
+	stats->Set(String::NewSymbol("written"),
+		   Integer::NewFromUnsigned(data.m_writeCnt));
+	stats->Set(String::NewSymbol("retries"),
+		   Integer::NewFromUnsigned(data.m_retries));
+	stats->Set(String::NewSymbol("dropped"),
+		   Integer::NewFromUnsigned(data.m_dropped));
+	stats->Set(String::NewSymbol("expired"),
+		   Integer::NewFromUnsigned(data.m_expired));
+	stats->Set(String::NewSymbol("coalesced"),
+		   Integer::NewFromUnsigned(data.m_coalesced));
+	stats->Set(String::NewSymbol("suppressed"),
+		   Integer::NewFromUnsigned(data.m_suppressed));
+	stats->Set(String::NewSymbol("savedbytes"),
+		   Integer::NewFromUnsigned(data.m_savedBytes));
+	stats->Set(String::NewSymbol("tripped"),
+		   Integer::NewFromUnsigned(data.m_tripped));
+	stats->Set(String::NewSymbol("parked"),
+		   Integer::NewFromUnsigned(data.m_parked));
+	stats->Set(String::NewSymbol("skippedpolls"),
+		   Integer::NewFromUnsigned(data.m_skippedPolls));
+
+	return scope.Close(stats);
+}
+
+static Persistent<String> symbol(const char *name)
+{
+	return Persistent<String>::New(String::NewSymbol(name));
+}
+
+/*
+ * Set up the state for a new environment.
+ */
+static AddonData *new_addon_data(uv_loop_t *loop)
+{
+	AddonData *d = new AddonData();
+
+	d->loop = loop;
+
+	d->sym_emit = symbol("emit");
+	d->sym_type = symbol("type");
+	d->sym_genre = symbol("genre");
+	d->sym_instance = symbol("instance");
+	d->sym_index = symbol("index");
+	d->sym_label = symbol("label");
+	d->sym_units = symbol("units");
+	d->sym_read_only = symbol("read_only");
+	d->sym_write_only = symbol("write_only");
+	d->sym_min = symbol("min");
+	d->sym_max = symbol("max");
+	d->sym_value = symbol("value");
+	d->sym_nodeid = symbol("nodeid");
+	d->sym_comclass = symbol("comclass");
+	d->sym_error = symbol("error");
+	d->sym_latency = symbol("latency");
+
+	d->ev_value_added = symbol("value added");
+	d->ev_value_changed = symbol("value changed");
+
+	for (int i = 0; i <= OpenZWave::ValueID::ValueType_Max; i++)
+		d->type_names[i] = symbol(OpenZWave::Value::GetTypeNameFromEnum(
+		    (OpenZWave::ValueID::ValueType)i));
+	for (int i = 0; i < OpenZWave::ValueID::ValueGenre_Count; i++)
+		d->genre_names[i] = symbol(OpenZWave::Value::GetGenreNameFromEnum(
+		    (OpenZWave::ValueID::ValueGenre)i));
+
+	/*
+	 * Properties are added in the same order as the async handler sets
+	 * them, so instances never change shape.
+	 */
+	d->value_tmpl = Persistent<ObjectTemplate>::New(ObjectTemplate::New());
+	d->value_tmpl->Set(d->sym_type, Undefined());
+	d->value_tmpl->Set(d->sym_genre, Undefined());
+	d->value_tmpl->Set(d->sym_instance, Undefined());
+	d->value_tmpl->Set(d->sym_index, Undefined());
+	d->value_tmpl->Set(d->sym_label, Undefined());
+	d->value_tmpl->Set(d->sym_units, Undefined());
+	d->value_tmpl->Set(d->sym_read_only, Undefined());
+	d->value_tmpl->Set(d->sym_write_only, Undefined());
+	d->value_tmpl->Set(d->sym_min, Undefined());
+	d->value_tmpl->Set(d->sym_max, Undefined());
+	d->value_tmpl->Set(d->sym_value, Undefined());
+
+	return d;
+}
+
+/*
+ * Return the Buffer backing the binary record stream, if enabled.
+ */
+Handle<Value> OZW::GetRecordBuffer(const Arguments& args)
+{
+	HandleScope scope;
+	OZW* self = ObjectWrap::Unwrap<OZW>(args.This());
+
+	if (self->record_data == NULL)
+		return scope.Close(Undefined());
+
+	return scope.Close(self->record_buf);
+}
+
+/*
+ * Return the metadata for a value, for use with the binary record stream
+ * which only carries the numeric value.
+ */
+Handle<Value> OZW::GetValueMeta(const Arguments& args)
+{
+	HandleScope scope;
+	OZW* self = ObjectWrap::Unwrap<OZW>(args.This());
+	AddonData *d = self->data;
+
+	uint8_t nodeid = args[0]->ToNumber()->Value();
+	uint8_t comclass = args[1]->ToNumber()->Value();
+	uint8_t instance = args[2]->ToNumber()->Value();
+	uint8_t index = args[3]->ToNumber()->Value();
+
+	OpenZWave::ValueID vid(0, (uint64)0);
+	ValueMeta *vm;
+
+	if (!self->zvalues.lookup(nodeid, comclass, instance, index, &vid) ||
+	    (vm = self->zmeta.find(ValueRegistry::key(vid))) == NULL)
+		return scope.Close(Undefined());
+
+	Local<Object> meta = Object::New();
+	meta->Set(d->sym_type, d->type_names[vid.GetType()]);
+	meta->Set(d->sym_genre, d->genre_names[vid.GetGenre()]);
+	meta->Set(d->sym_label, vm->label);
+	meta->Set(d->sym_units, vm->units);
+	meta->Set(d->sym_read_only, Boolean::New(vm->read_only));
+	meta->Set(d->sym_write_only, Boolean::New(vm->write_only));
+	meta->Set(d->sym_min, Integer::New(vm->min));
+	meta->Set(d->sym_max, Integer::New(vm->max));
+
+	return scope.Close(meta);
+}
+
+/*
+ * Return a summary of every node currently known, taken from OpenZWave in a
+ * single pass.  Useful for picking up the state of a network without having
+ * to replay every event since it was started.
+ */
+Handle<Value> OZW::GetNodes(const Arguments& args)
+{
+	HandleScope scope;
+	OZW* self = ObjectWrap::Unwrap<OZW>(args.This());
+	AddonData *d = self->data;
+	std::vector<OpenZWave::Node::NodeSnapshot> nodes;
+
+	if (self->homeid == 0 ||
+	    !OpenZWave::Manager::Get()->GetNodesSnapshot(self->homeid, &nodes))
+		return scope.Close(Array::New());
+
+	Local<Array> result = Array::New(nodes.size());
+	for (size_t i = 0; i < nodes.size(); i++) {
+		OpenZWave::Node::NodeSnapshot const &n = nodes[i];
+		Local<Object> info = Object::New();
+		info->Set(d->sym_nodeid, Integer::New(n.m_nodeId));
+		info->Set(String::NewSymbol("ready"), Boolean::New(n.m_ready));
+		info->Set(String::NewSymbol("alive"), Boolean::New(n.m_alive));
+		info->Set(String::NewSymbol("listening"), Boolean::New(n.m_listening));
+		info->Set(String::NewSymbol("manufacturer"), String::New(n.m_manufacturerName.c_str()));
+		info->Set(String::NewSymbol("manufacturerid"), String::New(n.m_manufacturerId.c_str()));
+		info->Set(String::NewSymbol("product"), String::New(n.m_productName.c_str()));
+		info->Set(String::NewSymbol("producttype"), String::New(n.m_productType.c_str()));
+		info->Set(String::NewSymbol("productid"), String::New(n.m_productId.c_str()));
+		info->Set(d->sym_type, String::New(n.m_type.c_str()));
+		info->Set(String::NewSymbol("name"), String::New(n.m_nodeName.c_str()));
+		info->Set(String::NewSymbol("loc"), String::New(n.m_location.c_str()));
+		info->Set(String::NewSymbol("values"), Integer::NewFromUnsigned(n.m_numValues));
+		info->Set(String::NewSymbol("queuewait"), Integer::NewFromUnsigned(n.m_averageQueueWait));
+		info->Set(String::NewSymbol("maxqueuewait"), Integer::NewFromUnsigned(n.m_maxQueueWait));
+		result->Set(i, info);
+	}
+
+	return scope.Close(result);
+}
+
+/*
+ * Return every value of a node, in the same form as the 'value added' event
+ * with the command class added.
+ */
+Handle<Value> OZW::GetValues(const Arguments& args)
+{
+	HandleScope scope;
+	OZW* self = ObjectWrap::Unwrap<OZW>(args.This());
+	uint8_t nodeid = args[0]->ToNumber()->Value();
+
+	if (self->homeid == 0)
+		return scope.Close(Array::New());
+
+	return scope.Close(node_values(self, nodeid, false));
+}
+
+/*
+ * Event names which can be subscribed to, and the notifications which
+ * produce them.
+ */
+static const struct {
+	const char			*name;
+	OpenZWave::Notification::NotificationType type;
+} event_types[] = {
+	{ "node added",		OpenZWave::Notification::Type_NodeAdded },
+	{ "node ready",		OpenZWave::Notification::Type_NodeQueriesComplete },
+	{ "value added",	OpenZWave::Notification::Type_ValueAdded },
+	{ "value changed",	OpenZWave::Notification::Type_ValueChanged },
+	{ "value removed",	OpenZWave::Notification::Type_ValueRemoved },
+	{ "scan complete",	OpenZWave::Notification::Type_AwakeNodesQueried },
+	{ "scan complete",	OpenZWave::Notification::Type_AllNodesQueried },
+	{ "scan complete",	OpenZWave::Notification::Type_AllNodesQueriedSomeDead },
+	{ "notification",	OpenZWave::Notification::Type_Notification },
+};
+
+/*
+ * Set a list of ids from a JavaScript array into a bitset, or everything
+ * if the list is not given.
+ */
+template <uint32_t N>
+static void subscribe_ids(AtomicBitset<N> &bits, Local<Value> list)
+{
+	AtomicBitset<N> want;
+
+	if (list->IsArray()) {
+		Local<Array> ids = Local<Array>::Cast(list);
+		want.fill(false);
+		for (uint32_t i = 0; i < ids->Length(); i++)
+			want.set(ids->Get(i)->Uint32Value());
+	}
+
+	bits.assign(want);
+}
+
+/*
+ * Restrict the notifications which are passed up from OpenZWave to the
+ * given nodes, command classes and event names.  Anything not specified
+ * matches everything, so subscribe({}) removes all filters.
+ */
+Handle<Value> OZW::Subscribe(const Arguments& args)
+{
+	HandleScope scope;
+	OZW* self = ObjectWrap::Unwrap<OZW>(args.This());
+	AtomicBitset<32> types;
+
+	if (!args[0]->IsObject()) {
+		ThrowException(Exception::TypeError(
+		    String::New("subscribe({nodes, commandClasses, types})")));
+		return scope.Close(Undefined());
+	}
+
+	Local<Object> opts = args[0]->ToObject();
+	Local<Value> names = opts->Get(String::NewSymbol("types"));
+
+	if (names->IsArray()) {
+		Local<Array> list = Local<Array>::Cast(names);
+		types.fill(false);
+		for (uint32_t i = 0; i < list->Length(); i++) {
+			std::string name = (*String::Utf8Value(list->Get(i)->ToString()));
+			bool found = false;
+			for (size_t j = 0; j < sizeof(event_types) / sizeof(event_types[0]); j++) {
+				if (name == event_types[j].name) {
+					types.set(event_types[j].type);
+					found = true;
+				}
+			}
+			if (!found) {
+				name = "unknown event type: " + name;
+				ThrowException(Exception::TypeError(
+				    String::New(name.c_str())));
+				return scope.Close(Undefined());
+			}
+		}
+	}
 
-	OpenZWave::Manager::Get()->SoftReset(homeid);
+	types.set(OpenZWave::Notification::Type_DriverReady);
+	types.set(OpenZWave::Notification::Type_DriverFailed);
+	types.set(OpenZWave::Notification::Type_DriverReset);
+	types.set(OpenZWave::Notification::Type_DriverRemoved);
+
+	subscribe_ids(self->sub_nodes, opts->Get(String::NewSymbol("nodes")));
+	subscribe_ids(self->sub_classes, opts->Get(String::NewSymbol("commandClasses")));
+	self->sub_types.assign(types);
 
 	return scope.Close(Undefined());
 }
 
+/*
+ * Everything which init() creates is owned by the environment it is called
+ * for, and reaches the instances through the constructor's data, so nothing
+ * but the shared Manager is process-global.
+ */
 extern "C" void init(Handle<Object> target)
 {
 	HandleScope scope;
 
-	Local<FunctionTemplate> t = FunctionTemplate::New(OZW::New);
+	AddonData *data = new_addon_data(uv_default_loop());
+
+	Local<FunctionTemplate> t = FunctionTemplate::New(OZW::New, External::New(data));
 	t->InstanceTemplate()->SetInternalFieldCount(1);
 	t->SetClassName(String::New("OZW"));
 
 	NODE_SET_PROTOTYPE_METHOD(t, "connect", OZW::Connect);
 	NODE_SET_PROTOTYPE_METHOD(t, "disconnect", OZW::Disconnect);
+	NODE_SET_PROTOTYPE_METHOD(t, "reconnect", OZW::Reconnect);
 	NODE_SET_PROTOTYPE_METHOD(t, "setValue", OZW::SetValue);
+	NODE_SET_PROTOTYPE_METHOD(t, "setValues", OZW::SetValues);
 	NODE_SET_PROTOTYPE_METHOD(t, "setLevel", OZW::SetLevel);
 	NODE_SET_PROTOTYPE_METHOD(t, "setLocation", OZW::SetLocation);
 	NODE_SET_PROTOTYPE_METHOD(t, "setName", OZW::SetName);
 	NODE_SET_PROTOTYPE_METHOD(t, "switchOn", OZW::SwitchOn);
 	NODE_SET_PROTOTYPE_METHOD(t, "switchOff", OZW::SwitchOff);
 	NODE_SET_PROTOTYPE_METHOD(t, "enablePoll", OZW::EnablePoll);
-	NODE_SET_PROTOTYPE_METHOD(t, "disablePoll", OZW::EnablePoll);
+	NODE_SET_PROTOTYPE_METHOD(t, "disablePoll", OZW::DisablePoll);
 	NODE_SET_PROTOTYPE_METHOD(t, "hardReset", OZW::HardReset);
 	NODE_SET_PROTOTYPE_METHOD(t, "softReset", OZW::SoftReset);
+	NODE_SET_PROTOTYPE_METHOD(t, "getQueueStats", OZW::GetQueueStats);
+	NODE_SET_PROTOTYPE_METHOD(t, "getLatencyStats", OZW::GetLatencyStats);
+	NODE_SET_PROTOTYPE_METHOD(t, "getDriverStats", OZW::GetDriverStats);
+	NODE_SET_PROTOTYPE_METHOD(t, "getRecordBuffer", OZW::GetRecordBuffer);
+	NODE_SET_PROTOTYPE_METHOD(t, "getValueMeta", OZW::GetValueMeta);
+	NODE_SET_PROTOTYPE_METHOD(t, "getNodes", OZW::GetNodes);
+	NODE_SET_PROTOTYPE_METHOD(t, "getValues", OZW::GetValues);
+	NODE_SET_PROTOTYPE_METHOD(t, "subscribe", OZW::Subscribe);
 
 	target->Set(String::NewSymbol("Emitter"), t->GetFunction());
 }
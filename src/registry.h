@@ -0,0 +1,359 @@
+/*
+ * Copyright (c) 2013 Jonathan Perkin <jonathan@perkin.org.uk>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef REGISTRY_H
+#define REGISTRY_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "ValueID.h"
+
+/*
+ * Open-addressed hash table keyed by a non-zero 32-bit integer, using
+ * linear probing and backward-shift deletion so that there are no
+ * tombstones.  Slots are allocated with calloc, so values must be simple
+ * types which are valid when zeroed and may be copied bitwise.
+ */
+template <typename T>
+class FlatMap {
+public:
+	typedef struct {
+		uint32_t	key;
+		T		val;
+	} Slot;
+
+	FlatMap(): slots(NULL), mask(0), count(0) {}
+	~FlatMap() { free(slots); }
+
+	uint32_t size() const { return count; }
+	uint32_t buckets() const { return slots ? mask + 1 : 0; }
+	Slot *bucket(uint32_t i) { return slots[i].key ? &slots[i] : NULL; }
+
+	T *find(uint32_t key)
+	{
+		if (slots == NULL)
+			return NULL;
+
+		for (uint32_t i = hash(key); slots[i].key; i = (i + 1) & mask) {
+			if (slots[i].key == key)
+				return &slots[i].val;
+		}
+
+		return NULL;
+	}
+
+	/*
+	 * Return the value for key, inserting a zeroed one if necessary.
+	 */
+	T *insert(uint32_t key)
+	{
+		uint32_t i;
+
+		if (slots == NULL || (count + 1) * 2 > mask + 1)
+			grow();
+
+		for (i = hash(key); slots[i].key; i = (i + 1) & mask) {
+			if (slots[i].key == key)
+				return &slots[i].val;
+		}
+
+		slots[i].key = key;
+		count++;
+
+		return &slots[i].val;
+	}
+
+	bool erase(uint32_t key)
+	{
+		uint32_t i, j, k;
+
+		if (slots == NULL)
+			return false;
+
+		for (i = hash(key); slots[i].key; i = (i + 1) & mask) {
+			if (slots[i].key == key)
+				break;
+		}
+		if (slots[i].key == 0)
+			return false;
+
+		/*
+		 * Shift back any following entries which would no longer be
+		 * reachable from their home bucket.
+		 */
+		for (j = (i + 1) & mask; slots[j].key; j = (j + 1) & mask) {
+			k = hash(slots[j].key);
+			if ((i <= j) ? (i < k && k <= j) : (i < k || k <= j))
+				continue;
+			slots[i] = slots[j];
+			i = j;
+		}
+		slots[i].key = 0;
+		slots[i].val = T();
+		count--;
+
+		return true;
+	}
+
+	void clear()
+	{
+		free(slots);
+		slots = NULL;
+		mask = count = 0;
+	}
+
+private:
+	FlatMap(const FlatMap&);
+	FlatMap& operator=(const FlatMap&);
+
+	uint32_t hash(uint32_t key) const
+	{
+		key *= 0x9e3779b1;
+		return (key ^ (key >> 16)) & mask;
+	}
+
+	void grow()
+	{
+		Slot *old = slots;
+		uint32_t oldsize = buckets();
+
+		mask = oldsize ? (oldsize * 2) - 1 : 63;
+		slots = (Slot *)calloc(mask + 1, sizeof(Slot));
+		count = 0;
+
+		for (uint32_t i = 0; i < oldsize; i++) {
+			if (old[i].key)
+				*insert(old[i].key) = old[i].val;
+		}
+		free(old);
+	}
+
+	Slot				*slots;
+	uint32_t			mask;
+	uint32_t			count;
+};
+
+typedef struct {
+	uint32_t			homeid;
+	uint64_t			id;
+} ValueEntry;
+
+/*
+ * The instances a (node, command class, index) value exists on, one bit
+ * per instance.
+ */
+typedef struct {
+	uint32_t			bits[8];
+} InstanceSet;
+
+/*
+ * Registry of all known values, keyed by (node, command class, instance,
+ * index), so that writes from JavaScript never have to search for their
+ * ValueID.  Alongside it we track the lowest (instance, index) value for
+ * each (node, command class) pair, which is what the per-class calls such
+ * as switchOn() and enablePoll() operate on, and the instances each
+ * (node, command class, index) value exists on, for writes which are not
+ * given an instance.
+ *
+ * Only accessed from the v8 thread, so no locking is required.
+ */
+class ValueRegistry {
+public:
+	static uint32_t key(uint8_t nodeid, uint8_t comclass, uint8_t instance,
+			    uint8_t index)
+	{
+		return ((uint32_t)nodeid << 24) | ((uint32_t)comclass << 16) |
+		       ((uint32_t)instance << 8) | index;
+	}
+	static uint32_t key(OpenZWave::ValueID const &value)
+	{
+		return key(value.GetNodeId(), value.GetCommandClassId(),
+			   value.GetInstance(), value.GetIndex());
+	}
+
+	void add(OpenZWave::ValueID const &value)
+	{
+		uint32_t k = key(value);
+		uint32_t *first;
+		InstanceSet *set;
+		ValueEntry *entry = values.insert(k);
+
+		entry->homeid = value.GetHomeId();
+		entry->id = value.GetId();
+
+		first = classes.insert(k >> 16);
+		if (*first == 0 || k < *first)
+			*first = k;
+
+		set = instances.insert(ikey(k));
+		set->bits[value.GetInstance() >> 5] |= 1U << (value.GetInstance() & 31);
+	}
+
+	void remove(OpenZWave::ValueID const &value)
+	{
+		uint32_t k = key(value);
+		uint32_t *first;
+		InstanceSet *set;
+
+		if (!values.erase(k))
+			return;
+
+		if ((first = classes.find(k >> 16)) && *first == k)
+			reindex(k >> 16);
+
+		if ((set = instances.find(ikey(k))) != NULL) {
+			set->bits[value.GetInstance() >> 5] &=
+			    ~(1U << (value.GetInstance() & 31));
+			for (int i = 0; i < 8; i++) {
+				if (set->bits[i])
+					return;
+			}
+			instances.erase(ikey(k));
+		}
+	}
+
+	/*
+	 * Forget every value belonging to a node.
+	 */
+	void remove_node(uint8_t nodeid)
+	{
+		std::vector<uint32_t> keys;
+
+		/*
+		 * Collect the keys first, erase() may shift entries around.
+		 */
+		for (uint32_t i = 0; i < values.buckets(); i++) {
+			FlatMap<ValueEntry>::Slot *s = values.bucket(i);
+			if (s && (s->key >> 24) == nodeid)
+				keys.push_back(s->key);
+		}
+		for (size_t i = 0; i < keys.size(); i++) {
+			values.erase(keys[i]);
+			classes.erase(keys[i] >> 16);
+			instances.erase(ikey(keys[i]));
+		}
+	}
+
+	bool lookup(uint8_t nodeid, uint8_t comclass, uint8_t instance,
+		    uint8_t index, OpenZWave::ValueID *value)
+	{
+		return get(key(nodeid, comclass, instance, index), value);
+	}
+
+	/*
+	 * Return every instance of a value on a node, lowest first.
+	 */
+	void lookup_instances(uint8_t nodeid, uint8_t comclass, uint8_t index,
+			      std::vector<OpenZWave::ValueID> *vids)
+	{
+		OpenZWave::ValueID value(0, (uint64)0);
+		uint32_t k = key(nodeid, comclass, 0, index);
+		InstanceSet *set;
+
+		if ((set = instances.find(ikey(k))) == NULL)
+			return;
+
+		for (uint32_t i = 0; i < 8; i++) {
+			for (uint32_t word = set->bits[i]; word; word &= word - 1) {
+				uint32_t instance = (i << 5) | __builtin_ctz(word);
+				if (lookup(nodeid, comclass, instance, index, &value))
+					vids->push_back(value);
+			}
+		}
+	}
+
+	/*
+	 * Return the lowest instance of a value on a node.
+	 */
+	bool lookup_first_instance(uint8_t nodeid, uint8_t comclass,
+				   uint8_t index, OpenZWave::ValueID *value)
+	{
+		uint32_t k = key(nodeid, comclass, 0, index);
+		InstanceSet *set;
+
+		if ((set = instances.find(ikey(k))) == NULL)
+			return false;
+
+		for (uint32_t i = 0; i < 8; i++) {
+			if (set->bits[i])
+				return lookup(nodeid, comclass,
+				    (i << 5) | __builtin_ctz(set->bits[i]),
+				    index, value);
+		}
+
+		return false;
+	}
+
+	/*
+	 * Return the first value of a command class on a node.
+	 */
+	bool lookup_class(uint8_t nodeid, uint8_t comclass,
+			  OpenZWave::ValueID *value)
+	{
+		uint32_t *first = classes.find(((uint32_t)nodeid << 8) | comclass);
+
+		return first && get(*first, value);
+	}
+
+private:
+	/*
+	 * Key of the instance set for a value key, leaving out the instance.
+	 */
+	static uint32_t ikey(uint32_t k)
+	{
+		return ((k >> 8) & 0xffff00) | (k & 0xff);
+	}
+
+	bool get(uint32_t k, OpenZWave::ValueID *value)
+	{
+		ValueEntry *entry;
+
+		if ((entry = values.find(k)) == NULL)
+			return false;
+
+		*value = OpenZWave::ValueID(entry->homeid, (uint64)entry->id);
+		return true;
+	}
+
+	/*
+	 * The first value of a class has been removed, find the next one.
+	 * This is a full walk, but removals are rare.
+	 */
+	void reindex(uint32_t ckey)
+	{
+		uint32_t first = 0;
+
+		for (uint32_t i = 0; i < values.buckets(); i++) {
+			FlatMap<ValueEntry>::Slot *s = values.bucket(i);
+			if (s && (s->key >> 16) == ckey &&
+			    (first == 0 || s->key < first))
+				first = s->key;
+		}
+
+		if (first)
+			*classes.insert(ckey) = first;
+		else
+			classes.erase(ckey);
+	}
+
+	FlatMap<ValueEntry>		values;
+	FlatMap<uint32_t>		classes;
+	FlatMap<InstanceSet>		instances;
+};
+
+#endif